@@ -10,14 +10,22 @@
  * Each bus owns a 64-bit IEEE 1722 stream ID: the interface MAC in the upper
  * 48 bits and the bus stream index (SPINALI_COE_STREAM_UID_BASE + bus) in the
  * lower 16, so a node's streams are unique on the network without
- * coordination. It also owns its own NTSCF sequence number. Frames queued by
- * the CAN receive callbacks are batched into a single AVTPDU per transmission
- * and sent to SPINALI_COE_DST_MAC, which is replaced by the source MAC of the
+ * coordination. It also owns its own NTSCF sequence number. Frames the CAN
+ * receive callbacks write into each bus's lock-free ring are read out in turn
+ * across the buses, batched into AVTPDUs staged per bus, and sent to
+ * SPINALI_COE_DST_MAC, which is replaced by the source MAC of the
  * first valid inbound AVTPDU. Inbound AVTPDUs are demultiplexed by the low 16
  * bit stream index and their ACF-CAN messages are queued to the matching bus,
  * which owns a writer
  * thread of its own so that a bus without a peer to acknowledge its frames
- * cannot hold up the other bus or the packet socket.
+ * cannot hold up the other buses or the packet socket. The buses are the CAN
+ * controllers listed by the spinali,coe devicetree node, up to 32.
+ *
+ * AVTPDUs toward Ethernet are encoded straight into the network buffers of a
+ * net_pkt, Ethernet header included, and handed to the L2, so a PDU is neither
+ * staged in a separate buffer nor copied by a socket send on the way out
+ * (SPINALI_COE_TX_NET_PKT). The packet socket transmit path remains selectable
+ * for comparison.
  *
  * Every frame bridged toward Ethernet carries the time of its arrival, taken
  * from the PTP hardware clock of the Ethernet MAC (PHC) and sent as the
@@ -37,6 +45,10 @@
 #include <zephyr/drivers/ptp_clock.h>
 #include <zephyr/net/ethernet.h>
 #include <zephyr/net/net_if.h>
+#if defined(CONFIG_SPINALI_COE_TX_NET_PKT)
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_pkt.h>
+#endif
 #include <zephyr/net/socket.h>
 #include <zephyr/sys/byteorder.h>
 #include <zephyr/logging/log.h>
@@ -49,7 +61,17 @@
 
 LOG_MODULE_REGISTER(coe, CONFIG_SPINALI_COE_LOG_LEVEL);
 
-#define COE_BUS_COUNT 2U
+/*
+ * The bridged buses are the CAN controllers of the spinali,coe node, in
+ * order; everything kept per bus is generated from that list.
+ */
+#define COE_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(spinali_coe)
+
+#if !DT_NODE_EXISTS(COE_NODE)
+#error "COE needs a spinali,coe devicetree node listing the CAN controllers to bridge"
+#endif
+
+#define COE_BUS_COUNT DT_PROP_LEN(COE_NODE, can_controllers)
 
 /* IEEE 1722 NTSCF control format header: three quadlets. */
 #define COE_AVTP_SUBTYPE_NTSCF 0x82U
@@ -73,6 +95,7 @@ LOG_MODULE_REGISTER(coe, CONFIG_SPINALI_COE_LOG_LEVEL);
 #define COE_ACF_CAN_ESI BIT(0)
 
 #define COE_PDU_MAX 1450U
+#define COE_ETH_HDR_LEN 14U
 #define COE_QUADLET 4U
 #define COE_CAN_ID_MASK 0x1FFFFFFFUL
 #define COE_CAN_STD_ID_MAX 0x7FFUL
@@ -85,9 +108,26 @@ LOG_MODULE_REGISTER(coe, CONFIG_SPINALI_COE_LOG_LEVEL);
  */
 #define COE_ACF_CAN_MSG_PER_PDU 15U
 
+/*
+ * Coalescing window: how long an AVTPDU that is not yet full waits for more
+ * frames of its bus before it is sent. The latency profile sends at once with
+ * whatever is already queued; the throughput profile trades up to the window
+ * of added latency for fewer, fuller AVTPDUs on a busy bus.
+ */
+#if defined(CONFIG_SPINALI_COE_PROFILE_THROUGHPUT)
+#define COE_COALESCE_US CONFIG_SPINALI_COE_COALESCE_US
+#define COE_PROFILE "throughput"
+#else
+#define COE_COALESCE_US 0U
+#define COE_PROFILE "latency"
+#endif
+
 /* Depth of the per-bus queue between the AVTPDU receiver and its bus writer. */
 #define COE_BUS_TXQ_DEPTH 32U
 
+/* Depth of each bus's ring between its CAN receive callback and the transmitter. */
+#define COE_RX_RING_DEPTH 32U
+
 /* Pause after a packet socket receive error, so a persistent fault cannot spin. */
 #define COE_RX_ERR_BACKOFF_MS 10U
 
@@ -102,6 +142,37 @@ LOG_MODULE_REGISTER(coe, CONFIG_SPINALI_COE_LOG_LEVEL);
 BUILD_ASSERT(COE_PDU_MAX - COE_NTSCF_HDR_LEN <= COE_NTSCF_DATA_LEN_MAX,
 	     "AVTPDU payload must fit the 11 bit ntscf_data_length field");
 BUILD_ASSERT(COE_BUS_COUNT <= 32U, "can_bus_id is a five bit field");
+BUILD_ASSERT(CONFIG_SPINALI_COE_STREAM_UID_BASE + COE_BUS_COUNT - 1 <= UINT16_MAX,
+	     "every bus needs a stream index of its own");
+BUILD_ASSERT(sizeof(struct net_eth_hdr) == COE_ETH_HDR_LEN);
+BUILD_ASSERT(IS_POWER_OF_TWO(COE_RX_RING_DEPTH), "ring indices wrap by masking");
+
+#if defined(CONFIG_SPINALI_COE_TX_NET_PKT)
+/*
+ * A transmit packet starts as one network buffer holding the Ethernet and
+ * NTSCF headers and the first ACF-CAN message, and grows a buffer at a time.
+ * Every message is written whole into a single buffer, so a fixed buffer size
+ * must hold the headers and a maximal message.
+ */
+#define COE_PKT_FIRST_LEN (COE_ETH_HDR_LEN + COE_NTSCF_HDR_LEN + COE_ACF_CAN_MSG_MAX)
+
+#if !defined(CONFIG_NET_BUF_VARIABLE_DATA_SIZE)
+BUILD_ASSERT(CONFIG_NET_BUF_DATA_SIZE >= COE_PKT_FIRST_LEN,
+	     "a network buffer must hold the headers and one ACF-CAN message");
+#endif
+
+/*
+ * Every bus with a frame staged holds one transmit packet until its AVTPDU is
+ * sent, so with all buses busy the bridge holds one per bus. Half the packets
+ * stay free for gPTP, mcumgr and the rest of the stack.
+ */
+BUILD_ASSERT(COE_BUS_COUNT <= CONFIG_NET_PKT_TX_COUNT / 2,
+	     "raise CONFIG_NET_PKT_TX_COUNT to at least twice the bridged bus count");
+
+#define COE_TX_PATH "net_pkt"
+#else
+#define COE_TX_PATH "socket"
+#endif
 
 struct coe_msg {
 	/* PHC time of frame arrival, in nanoseconds on the PTP timescale.
@@ -113,6 +184,46 @@ struct coe_msg {
 	bool ts_valid;
 };
 
+/*
+ * Single-producer single-consumer ring of frames bound for Ethernet, one per
+ * bus. The bus's CAN receive callback is the only producer and writes the
+ * message straight into the slot at head; the transmit thread is the only
+ * consumer and encodes from the slot at tail before releasing it. Head and
+ * tail run free and are masked on use, and each is stored by its own side
+ * only, so no lock is taken; the atomic store that publishes an index orders
+ * the slot contents before it.
+ */
+struct coe_ring {
+	struct coe_msg slot[COE_RX_RING_DEPTH];
+	atomic_t head;
+	atomic_t tail;
+	uint32_t drop; /* frames shed because the ring was full */
+	uint32_t hwm; /* most slots ever in use */
+	bool full; /* dropping since the last frame that found room */
+};
+
+/*
+ * An AVTPDU under construction, one staged per bus so interleaved buses batch
+ * independently. On the net_pkt path it is built in the network buffers that
+ * go to the driver, behind an Ethernet header whose destination is filled in
+ * at send time; on the socket path in a buffer that the send copies from.
+ */
+struct coe_pdu {
+#if defined(CONFIG_SPINALI_COE_TX_NET_PKT)
+	struct net_pkt *pkt;
+	uint8_t *eth;
+#else
+	uint8_t buf[COE_PDU_MAX];
+#endif
+	uint8_t *ntscf; /* written once the payload length is known */
+	size_t len; /* AVTPDU octets, NTSCF header included */
+	bool open;
+	unsigned int count; /* ACF-CAN messages staged, 0 while empty */
+	int64_t deadline; /* uptime ticks by which a non-empty PDU is sent */
+	uint32_t first_msg; /* g_tx_msgs when its first message was staged */
+	uint32_t cost_cyc; /* CPU time spent on it so far */
+};
+
 struct coe_bus {
 	const struct device *dev;
 	struct k_msgq *txq;
@@ -126,16 +237,36 @@ struct coe_bus {
 	uint32_t tx_pdu;
 	uint32_t tx_err;
 	int tx_errno_last;
+	uint32_t tx_nobuf; /* frames left in the ring for want of a transmit packet */
+	struct coe_ring ring;
+	struct coe_pdu pdu;
+	/* CPU time per AVTPDU sent: encoding its messages plus the send, not
+	 * the time it sat staged; obtaining its packet and buffers is kept
+	 * apart in tx_alloc_cyc
+	 */
+	uint32_t tx_cost_n;
+	uint32_t tx_cost_max_cyc;
+	uint64_t tx_cost_cyc;
+	uint64_t tx_alloc_cyc;
+	/* AVTPDUs sent by ACF-CAN messages carried, entry n for n + 1 */
+	uint32_t tx_pdu_msgs[COE_ACF_CAN_MSG_PER_PDU];
 };
 
 /* One queue per bus, so a bus that cannot transmit only backs up its own. */
-K_MSGQ_DEFINE(g_txq0, sizeof(struct can_frame), COE_BUS_TXQ_DEPTH, 4);
-K_MSGQ_DEFINE(g_txq1, sizeof(struct can_frame), COE_BUS_TXQ_DEPTH, 4);
+#define COE_BUS_TXQ_DEFINE(node_id, prop, idx)                                                     \
+	K_MSGQ_DEFINE(g_txq##idx, sizeof(struct can_frame), COE_BUS_TXQ_DEPTH, 4);
+
+DT_FOREACH_PROP_ELEM(COE_NODE, can_controllers, COE_BUS_TXQ_DEFINE)
+
+#define COE_BUS_INIT(node_id, prop, idx)                                                           \
+	{                                                                                          \
+		.dev = DEVICE_DT_GET(DT_PHANDLE_BY_IDX(node_id, prop, idx)),                       \
+		.txq = &g_txq##idx,                                                                \
+		.txq_up = true,                                                                    \
+	},
 
 static struct coe_bus g_bus[COE_BUS_COUNT] = {
-	{.dev = DEVICE_DT_GET(DT_ALIAS(coe_can0)), .txq = &g_txq0, .txq_up = true},
-	{.dev = DEVICE_DT_GET(DT_ALIAS(coe_can1)), .txq = &g_txq1, .txq_up = true},
-};
+	DT_FOREACH_PROP_ELEM(COE_NODE, can_controllers, COE_BUS_INIT)};
 
 /* Multicast destination inside the MAAP dynamic pool. */
 static const uint8_t g_dst_mac_fallback[NET_ETH_ADDR_LEN] = {0x91, 0xE0, 0xF0, 0x00, 0x0C, 0x0E};
@@ -145,7 +276,12 @@ static bool g_peer_known;
 static struct k_spinlock g_dst_lock;
 
 static int g_sock_rx = -1;
+#if defined(CONFIG_SPINALI_COE_TX_NET_PKT)
+static struct net_if *g_iface;
+static uint8_t g_src_mac[NET_ETH_ADDR_LEN];
+#else
 static int g_sock_tx = -1;
+#endif
 static int g_ifindex;
 
 /* PTP hardware clock of the Ethernet MAC, resolved once at start up. NULL
@@ -153,8 +289,14 @@ static int g_ifindex;
  */
 static const struct device *g_phc;
 
-/* Aligned to the message type: an entry carries a 64 bit timestamp. */
-K_MSGQ_DEFINE(g_canq, sizeof(struct coe_msg), 32, __alignof__(struct coe_msg));
+/* Messages the transmitter has staged across all buses, and whether its last
+ * send succeeded. Owned by the transmit thread.
+ */
+static uint32_t g_tx_msgs;
+static bool g_tx_up = true;
+
+/* Given by a CAN receive callback whose ring the transmitter may have drained. */
+static K_SEM_DEFINE(g_tx_kick, 0, 1);
 static K_SEM_DEFINE(g_ready, 0, 1);
 
 /* Gate that holds the transport threads until the sockets and the buses are up. */
@@ -268,19 +410,48 @@ static inline bool coe_disciplined(void)
  */
 static void coe_rx_cb(const struct device *dev, struct can_frame *frame, void *user_data)
 {
-	struct coe_msg msg = {.bus = (uint8_t)(uintptr_t)user_data, .frame = *frame};
+	uint8_t index = (uint8_t)(uintptr_t)user_data;
+	struct coe_ring *ring = &g_bus[index].ring;
+	uint32_t head = (uint32_t)atomic_get(&ring->head);
+	uint32_t tail = (uint32_t)atomic_get(&ring->tail);
+	struct coe_msg *msg;
 	struct net_ptp_time now;
 
 	ARG_UNUSED(dev);
 
+	g_bus[index].rx_can++;
+	if (head - tail == COE_RX_RING_DEPTH) {
+		ring->drop++;
+		if (!ring->full) {
+			LOG_WRN("can%u: transport ring full, frames dropped", index);
+			ring->full = true;
+		}
+		return;
+	}
+	if (ring->full) {
+		LOG_INF("can%u: transport ring draining, %u frames dropped", index, ring->drop);
+		ring->full = false;
+	}
+
+	msg = &ring->slot[head & (COE_RX_RING_DEPTH - 1U)];
+	msg->frame = *frame;
+	msg->bus = index;
+	msg->ts_valid = false;
 	if ((g_phc != NULL) && coe_disciplined() && (ptp_clock_get(g_phc, &now) == 0)) {
-		msg.ts_ns = ((uint64_t)now.second * NSEC_PER_SEC) + now.nanosecond;
-		msg.ts_valid = true;
+		msg->ts_ns = ((uint64_t)now.second * NSEC_PER_SEC) + now.nanosecond;
+		msg->ts_valid = true;
 	}
 
-	g_bus[msg.bus].rx_can++;
-	if (k_msgq_put(&g_canq, &msg, K_NO_WAIT) != 0) {
-		LOG_WRN("can%u: transport queue full, frame dropped", msg.bus);
+	ring->hwm = MAX(ring->hwm, head + 1U - tail);
+	atomic_set(&ring->head, (atomic_val_t)(head + 1U));
+	/*
+	 * The transmitter sleeps only once it has found every ring empty, so
+	 * a kick is owed only if this frame may have landed in a drained ring.
+	 * Reading tail after publishing head pairs with the transmitter
+	 * releasing tail before it reads head: one side sees the other.
+	 */
+	if ((uint32_t)atomic_get(&ring->tail) == head) {
+		k_sem_give(&g_tx_kick);
 	}
 }
 
@@ -294,13 +465,28 @@ static void coe_ntscf_write(uint8_t *out, uint64_t stream_id, uint8_t seq, uint1
 	sys_put_be64(stream_id, &out[4]);
 }
 
-/* Encodes one CAN frame as an ACF-CAN message and returns its octet count. */
-static size_t coe_acf_can_encode(const struct coe_msg *msg, uint8_t *out)
+/* Octets of CAN data the ACF-CAN message of a frame carries. */
+static uint8_t coe_can_data_len(const struct can_frame *frame)
+{
+	if ((frame->flags & CAN_FRAME_FDF) != 0U) {
+		return can_dlc_to_bytes(frame->dlc);
+	}
+	return (uint8_t)MIN(frame->dlc, CAN_MAX_DLC);
+}
+
+/* Octets of the ACF-CAN message of a frame, padding included. */
+static size_t coe_acf_can_len(const struct can_frame *frame)
+{
+	return ROUND_UP(COE_ACF_CAN_HDR_LEN + coe_can_data_len(frame), COE_QUADLET);
+}
+
+/* Encodes one CAN frame as an ACF-CAN message of coe_acf_can_len() octets. */
+static void coe_acf_can_encode(const struct coe_msg *msg, uint8_t *out)
 {
 	const struct can_frame *frame = &msg->frame;
 	bool fd = (frame->flags & CAN_FRAME_FDF) != 0U;
 	bool rtr = (frame->flags & CAN_FRAME_RTR) != 0U;
-	uint8_t len = fd ? can_dlc_to_bytes(frame->dlc) : (uint8_t)MIN(frame->dlc, CAN_MAX_DLC);
+	uint8_t len = coe_can_data_len(frame);
 	uint8_t pad = (uint8_t)((COE_QUADLET - (len % COE_QUADLET)) % COE_QUADLET);
 	uint16_t quadlets = (uint16_t)((COE_ACF_CAN_HDR_LEN + len + pad) / COE_QUADLET);
 	uint8_t flags = (uint8_t)(pad << 6);
@@ -342,8 +528,6 @@ static size_t coe_acf_can_encode(const struct coe_msg *msg, uint8_t *out)
 		memcpy(&out[COE_ACF_CAN_HDR_LEN], frame->data, len);
 	}
 	memset(&out[COE_ACF_CAN_HDR_LEN + len], 0, pad);
-
-	return (size_t)COE_ACF_CAN_HDR_LEN + len + pad;
 }
 
 /* Decodes one bounds-checked ACF-CAN message of msg_len octets. */
@@ -401,60 +585,338 @@ static int coe_acf_can_decode(const uint8_t *msg, size_t msg_len, struct can_fra
 	return 0;
 }
 
-static void coe_tx_thread(void *a, void *b, void *c)
+#if defined(CONFIG_SPINALI_COE_TX_NET_PKT)
+/*
+ * Allocates the packet of the bus's next AVTPDU and writes what is known of
+ * its headers. Called when the first frame is staged, so an idle bus holds no
+ * transmit packet; its first buffer already holds a maximal message, so the
+ * PDU allocates again only if it outgrows that buffer.
+ */
+static int coe_pdu_open(struct coe_pdu *pdu)
+{
+	pdu->pkt = net_pkt_alloc_with_buffer(g_iface, COE_PKT_FIRST_LEN, AF_PACKET, 0, K_NO_WAIT);
+	if (pdu->pkt == NULL) {
+		return -ENOMEM;
+	}
+
+	/* A packet with no socket context behind it is sent as the raw frame. */
+	pdu->eth = net_buf_add(pdu->pkt->buffer, COE_ETH_HDR_LEN + COE_NTSCF_HDR_LEN);
+	memcpy(&pdu->eth[NET_ETH_ADDR_LEN], g_src_mac, NET_ETH_ADDR_LEN);
+	sys_put_be16(ETH_P_TSN, &pdu->eth[2U * NET_ETH_ADDR_LEN]);
+	pdu->ntscf = &pdu->eth[COE_ETH_HDR_LEN];
+	pdu->len = COE_NTSCF_HDR_LEN;
+	pdu->open = true;
+	return 0;
+}
+
+/*
+ * Room for len more octets at the end of the PDU, contiguous, or NULL when a
+ * further buffer is needed and none is free.
+ */
+static uint8_t *coe_pdu_reserve(struct coe_pdu *pdu, size_t len)
+{
+	struct net_buf *frag = net_buf_frag_last(pdu->pkt->buffer);
+
+	if (net_buf_tailroom(frag) < len) {
+		frag = net_pkt_get_frag(pdu->pkt, COE_ACF_CAN_MSG_MAX, K_NO_WAIT);
+		if (frag == NULL) {
+			return NULL;
+		}
+		net_pkt_append_buffer(pdu->pkt, frag);
+	}
+
+	pdu->len += len;
+	return net_buf_add(frag, len);
+}
+
+/*
+ * Hands the packet to the L2, which owns and releases it once the send is
+ * accepted; a refused packet is still ours, and is released here.
+ */
+static int coe_pdu_send(struct coe_pdu *pdu)
+{
+	struct net_pkt *pkt = pdu->pkt;
+	int ret;
+
+	pdu->pkt = NULL;
+	pdu->open = false;
+	coe_dst_get(pdu->eth);
+	ret = net_send_data(pkt);
+	if (ret < 0) {
+		net_pkt_unref(pkt);
+	}
+	return ret;
+}
+#else
+static int coe_pdu_open(struct coe_pdu *pdu)
+{
+	pdu->ntscf = pdu->buf;
+	pdu->len = COE_NTSCF_HDR_LEN;
+	pdu->open = true;
+	return 0;
+}
+
+static uint8_t *coe_pdu_reserve(struct coe_pdu *pdu, size_t len)
+{
+	uint8_t *out = &pdu->buf[pdu->len];
+
+	if (pdu->len + len > COE_PDU_MAX) {
+		return NULL;
+	}
+	pdu->len += len;
+	return out;
+}
+
+static int coe_pdu_send(struct coe_pdu *pdu)
 {
-	ARG_UNUSED(a);
-	ARG_UNUSED(b);
-	ARG_UNUSED(c);
-	static uint8_t pdu[COE_PDU_MAX];
 	struct sockaddr_ll dst = {
 		.sll_family = AF_PACKET,
 		.sll_protocol = htons(ETH_P_TSN),
+		.sll_ifindex = g_ifindex,
 		.sll_halen = NET_ETH_ADDR_LEN,
 	};
-	struct coe_msg msg;
-	bool tx_up = true;
+
+	pdu->open = false;
+	coe_dst_get(dst.sll_addr);
+	if (zsock_sendto(g_sock_tx, pdu->buf, pdu->len, 0, (struct sockaddr *)&dst,
+			 sizeof(dst)) < 0) {
+		return -errno;
+	}
+	return 0;
+}
+#endif /* CONFIG_SPINALI_COE_TX_NET_PKT */
+
+static void coe_tx_cost(struct coe_bus *bus, uint32_t cyc)
+{
+	bus->tx_cost_n++;
+	bus->tx_cost_cyc += cyc;
+	bus->tx_cost_max_cyc = MAX(bus->tx_cost_max_cyc, cyc);
+}
+
+/* Sends the bus's staged AVTPDU and opens the next one in its place. */
+static void coe_pdu_flush(struct coe_bus *bus)
+{
+	struct coe_pdu *pdu = &bus->pdu;
+	uint32_t start = k_cycle_get_32();
+	unsigned int count = pdu->count;
+	int ret;
+
+	coe_ntscf_write(pdu->ntscf, bus->stream_id, bus->seq,
+			(uint16_t)(pdu->len - COE_NTSCF_HDR_LEN));
+
+	ret = coe_pdu_send(pdu);
+	coe_tx_cost(bus, pdu->cost_cyc + (k_cycle_get_32() - start));
+	pdu->count = 0U;
+	pdu->cost_cyc = 0U;
+	if (ret == 0) {
+		/* Receivers account for loss by sequence continuity, so a
+		 * number is consumed only by a PDU that reached the wire.
+		 */
+		bus->seq++;
+		bus->tx_pdu++;
+		bus->tx_pdu_msgs[count - 1U]++;
+		if (!g_tx_up) {
+			LOG_INF("transport up");
+			g_tx_up = true;
+		}
+	} else {
+		bus->tx_err++;
+		bus->tx_errno_last = -ret;
+		if (g_tx_up) {
+			LOG_WRN("send failed: %d", -ret);
+			g_tx_up = false;
+		}
+	}
+}
+
+/*
+ * Room for a message in the bus's staged PDU, opening one if none is. Never
+ * waits for a packet: the one transmitter serves every bus, and a wait on one
+ * bus's behalf would leave every ring undrained.
+ */
+static uint8_t *coe_pdu_stage(struct coe_pdu *pdu, size_t len)
+{
+	if (!pdu->open && coe_pdu_open(pdu) != 0) {
+		return NULL;
+	}
+	return coe_pdu_reserve(pdu, len);
+}
+
+/*
+ * Encodes a message into its bus's staged AVTPDU, and sends the PDU once it
+ * holds the most messages a listener accepts or could not take a maximal one
+ * more. Every bus stages its own PDU, so frames of interleaved buses batch as
+ * well as frames of one. Returns -ENOMEM, with nothing staged, when no
+ * transmit packet is free; the message is then to stay in its ring.
+ */
+static int coe_tx_stage(const struct coe_msg *msg)
+{
+	struct coe_bus *bus = &g_bus[msg->bus];
+	struct coe_pdu *pdu = &bus->pdu;
+	uint32_t start = k_cycle_get_32();
+	size_t len = coe_acf_can_len(&msg->frame);
+	uint8_t *out = coe_pdu_stage(pdu, len);
+
+	if (out == NULL && pdu->count != 0U) {
+		/* out of buffers: send what is staged and start the next PDU */
+		coe_pdu_flush(bus);
+		start = k_cycle_get_32();
+		out = coe_pdu_stage(pdu, len);
+	}
+	if (out == NULL) {
+		bus->tx_nobuf++;
+		return -ENOMEM;
+	}
+	bus->tx_alloc_cyc += k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+	coe_acf_can_encode(msg, out);
+	if (pdu->count++ == 0U) {
+		pdu->deadline = k_uptime_ticks() + (int64_t)k_us_to_ticks_ceil64(COE_COALESCE_US);
+		pdu->first_msg = g_tx_msgs;
+	}
+	g_tx_msgs++;
+	pdu->cost_cyc += k_cycle_get_32() - start;
+
+	if (pdu->count == COE_ACF_CAN_MSG_PER_PDU ||
+	    pdu->len + COE_ACF_CAN_MSG_MAX > COE_PDU_MAX) {
+		coe_pdu_flush(bus);
+	}
+	return 0;
+}
+
+/*
+ * The oldest unread message of the next bus after the last one served that has
+ * any, or NULL when every ring is empty. Taking one message per bus in turn
+ * keeps a busy bus from starving a quiet one.
+ */
+static const struct coe_msg *coe_ring_next(uint8_t *index)
+{
+	static uint8_t last = COE_BUS_COUNT - 1U;
+
+	for (uint8_t n = 0; n < COE_BUS_COUNT; n++) {
+		uint8_t i = (uint8_t)((last + 1U + n) % COE_BUS_COUNT);
+		struct coe_ring *ring = &g_bus[i].ring;
+		uint32_t tail = (uint32_t)atomic_get(&ring->tail);
+
+		if ((uint32_t)atomic_get(&ring->head) != tail) {
+			last = i;
+			*index = i;
+			return &ring->slot[tail & (COE_RX_RING_DEPTH - 1U)];
+		}
+	}
+	return NULL;
+}
+
+/* Hands the slot coe_ring_next() returned back to the bus's receive callback. */
+static void coe_ring_release(struct coe_ring *ring)
+{
+	atomic_inc(&ring->tail);
+}
+
+#if COE_COALESCE_US == 0
+static bool coe_rings_empty(void)
+{
+	for (uint8_t i = 0; i < COE_BUS_COUNT; i++) {
+		if (atomic_get(&g_bus[i].ring.head) != atomic_get(&g_bus[i].ring.tail)) {
+			return false;
+		}
+	}
+	return true;
+}
+#endif
+
+/*
+ * Whether a staged AVTPDU is due. In the throughput profile that is when its
+ * coalescing window closes. In the latency profile it is when the rings have
+ * drained, or the transmitter has read a ring's depth of messages since the
+ * PDU's first, so a frame waits staged about as long as it could wait in a
+ * ring.
+ */
+static bool coe_pdu_due(const struct coe_pdu *pdu, int64_t now)
+{
+	if (pdu->count == 0U) {
+		return false;
+	}
+#if COE_COALESCE_US > 0
+	return now >= pdu->deadline;
+#else
+	ARG_UNUSED(now);
+	return coe_rings_empty() || g_tx_msgs - pdu->first_msg >= COE_RX_RING_DEPTH;
+#endif
+}
+
+/*
+ * Ticks the transmitter may sleep, until the earliest staged deadline, or -1
+ * when nothing is staged.
+ */
+static int64_t coe_tx_wait(int64_t now)
+{
+	int64_t next = INT64_MAX;
+
+	for (uint8_t i = 0; i < COE_BUS_COUNT; i++) {
+		if (g_bus[i].pdu.count != 0U) {
+			next = MIN(next, g_bus[i].pdu.deadline);
+		}
+	}
+	if (next == INT64_MAX) {
+		return -1;
+	}
+	return MAX(next - now, 0);
+}
+
+static void coe_tx_thread(void *a, void *b, void *c)
+{
+	ARG_UNUSED(a);
+	ARG_UNUSED(b);
+	ARG_UNUSED(c);
+
+	/* messages in a row left in their ring for want of a packet */
+	uint32_t stalled = 0U;
 
 	coe_wait_ready();
-	dst.sll_ifindex = g_ifindex;
 
 	while (true) {
-		k_msgq_get(&g_canq, &msg, K_FOREVER);
-		struct coe_bus *bus = &g_bus[msg.bus];
-		size_t n = COE_NTSCF_HDR_LEN;
-		unsigned int count = 1U;
-		struct coe_msg more;
-
-		n += coe_acf_can_encode(&msg, &pdu[n]);
-		/* opportunistically batch whatever else is queued for this bus */
-		while (count < COE_ACF_CAN_MSG_PER_PDU &&
-		       n + COE_ACF_CAN_MSG_MAX <= COE_PDU_MAX &&
-		       k_msgq_peek(&g_canq, &more) == 0 && more.bus == msg.bus) {
-			k_msgq_get(&g_canq, &more, K_NO_WAIT);
-			n += coe_acf_can_encode(&more, &pdu[n]);
-			count++;
-		}
-		coe_ntscf_write(pdu, bus->stream_id, bus->seq, (uint16_t)(n - COE_NTSCF_HDR_LEN));
-
-		coe_dst_get(dst.sll_addr);
-		if (zsock_sendto(g_sock_tx, pdu, n, 0, (struct sockaddr *)&dst, sizeof(dst)) >= 0) {
-			/* Receivers account for loss by sequence continuity, so a
-			 * number is consumed only by a PDU that reached the wire.
+		uint8_t index;
+		const struct coe_msg *msg = coe_ring_next(&index);
+		int64_t now;
+
+		if (msg != NULL) {
+			/* Encoded from the ring slot, which is released after. A
+			 * message that found no packet stays, and the next bus is
+			 * served; its own ring backs up, and sheds once full. What
+			 * the other buses have staged goes out at once, so the
+			 * packets they hold come back.
 			 */
-			bus->seq++;
-			bus->tx_pdu++;
-			if (!tx_up) {
-				LOG_INF("transport up");
-				tx_up = true;
+			if (coe_tx_stage(msg) == 0) {
+				coe_ring_release(&g_bus[index].ring);
+				stalled = 0U;
+			} else {
+				stalled++;
+				for (uint8_t i = 0; i < COE_BUS_COUNT; i++) {
+					if (g_bus[i].pdu.count != 0U) {
+						coe_pdu_flush(&g_bus[i]);
+					}
+				}
 			}
-		} else {
-			bus->tx_err++;
-			bus->tx_errno_last = errno;
-			if (tx_up) {
-				LOG_WRN("send failed: %d", errno);
-				tx_up = false;
+		}
+
+		now = k_uptime_ticks();
+		for (uint8_t i = 0; i < COE_BUS_COUNT; i++) {
+			if (coe_pdu_due(&g_bus[i].pdu, now)) {
+				coe_pdu_flush(&g_bus[i]);
 			}
 		}
+
+		if (msg == NULL) {
+			int64_t wait = coe_tx_wait(now);
+
+			(void)k_sem_take(&g_tx_kick, wait < 0 ? K_FOREVER : K_TICKS(wait));
+		} else if (stalled >= COE_BUS_COUNT) {
+			/* every waiting bus is out of packets: let the L2 free some */
+			k_sleep(K_TICKS(1));
+			stalled = 0U;
+		}
 	}
 }
 
@@ -597,8 +1059,12 @@ static void coe_bus_thread(void *a, void *b, void *c)
 
 K_THREAD_DEFINE(coe_tx, 4096, coe_tx_thread, NULL, NULL, NULL, 6, 0, 0);
 K_THREAD_DEFINE(coe_rx, 4096, coe_rx_thread, NULL, NULL, NULL, 6, 0, 0);
-K_THREAD_DEFINE(coe_bus0, 2048, coe_bus_thread, (void *)(uintptr_t)0, NULL, NULL, 6, 0, 0);
-K_THREAD_DEFINE(coe_bus1, 2048, coe_bus_thread, (void *)(uintptr_t)1, NULL, NULL, 6, 0, 0);
+
+#define COE_BUS_THREAD_DEFINE(node_id, prop, idx)                                                  \
+	K_THREAD_DEFINE(coe_bus##idx, 2048, coe_bus_thread, (void *)(uintptr_t)idx, NULL, NULL, 6, \
+			0, 0);
+
+DT_FOREACH_PROP_ELEM(COE_NODE, can_controllers, COE_BUS_THREAD_DEFINE)
 
 #if defined(CONFIG_SHELL)
 /* Bench read-out of the counters each path keeps, reachable over the same
@@ -618,9 +1084,22 @@ static int cmd_coe_stats(const struct shell *sh, size_t argc, char **argv)
 
 		shell_print(sh,
 			    "bus%u: rx_can %u tx_can %u tx_drop %u rx_pdu %u tx_pdu %u "
-			    "tx_err %u errno %d",
+			    "tx_err %u errno %d tx_nobuf %u",
 			    (unsigned int)i, bus->rx_can, bus->tx_can, bus->tx_drop,
-			    bus->rx_pdu, bus->tx_pdu, bus->tx_err, bus->tx_errno_last);
+			    bus->rx_pdu, bus->tx_pdu, bus->tx_err, bus->tx_errno_last,
+			    bus->tx_nobuf);
+		shell_print(sh, "bus%u: ring drop %u high water %u of %u", (unsigned int)i,
+			    bus->ring.drop, bus->ring.hwm, (unsigned int)COE_RX_RING_DEPTH);
+		uint32_t n = MAX(bus->tx_cost_n, 1U);
+		uint64_t mean_cyc = bus->tx_cost_cyc / n;
+		uint64_t alloc_cyc = bus->tx_alloc_cyc / n;
+
+		shell_print(sh,
+			    "bus%u: pdu cost mean %u ns max %u ns, alloc mean %u ns "
+			    "over %u (%s)",
+			    (unsigned int)i, (uint32_t)k_cyc_to_ns_floor64(mean_cyc),
+			    (uint32_t)k_cyc_to_ns_floor64(bus->tx_cost_max_cyc),
+			    (uint32_t)k_cyc_to_ns_floor64(alloc_cyc), bus->tx_cost_n, COE_TX_PATH);
 	}
 
 	key = k_spin_lock(&g_dst_lock);
@@ -637,9 +1116,40 @@ static int cmd_coe_stats(const struct shell *sh, size_t argc, char **argv)
 	return 0;
 }
 
+/* Messages per AVTPDU sent, per bus: how well the coalescing window works. */
+static int cmd_coe_batch(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "profile %s, window %u us, at most %u messages per AVTPDU", COE_PROFILE,
+		    (unsigned int)COE_COALESCE_US, (unsigned int)COE_ACF_CAN_MSG_PER_PDU);
+
+	for (uint8_t i = 0; i < COE_BUS_COUNT; i++) {
+		const struct coe_bus *bus = &g_bus[i];
+		uint64_t msgs = 0U;
+
+		for (uint8_t n = 0; n < COE_ACF_CAN_MSG_PER_PDU; n++) {
+			msgs += (uint64_t)bus->tx_pdu_msgs[n] * (n + 1U);
+		}
+		shell_print(sh, "bus%u: %u AVTPDUs, %llu messages", (unsigned int)i, bus->tx_pdu,
+			    (unsigned long long)msgs);
+		for (uint8_t n = 0; n < COE_ACF_CAN_MSG_PER_PDU; n++) {
+			if (bus->tx_pdu_msgs[n] != 0U) {
+				shell_print(sh, "  %2u: %u", (unsigned int)n + 1U,
+					    bus->tx_pdu_msgs[n]);
+			}
+		}
+	}
+
+	return 0;
+}
+
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_coe,
 			       SHELL_CMD(stats, NULL, "Per bus counters and bridge state.",
 					 cmd_coe_stats),
+			       SHELL_CMD(batch, NULL, "Per bus histogram of messages per AVTPDU.",
+					 cmd_coe_batch),
 			       SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(coe, &sub_coe, "CAN over Ethernet commands", NULL);
@@ -655,6 +1165,9 @@ int main(void)
 		memcpy(g_dst_mac, g_dst_mac_fallback, sizeof(g_dst_mac));
 	}
 
+#if defined(CONFIG_SPINALI_COE_TX_NET_PKT)
+	g_iface = net_if_get_default();
+#endif
 	g_ifindex = net_if_get_by_iface(net_if_get_default());
 	if (g_ifindex < 0) {
 		LOG_ERR("no default network interface");
@@ -673,6 +1186,9 @@ int main(void)
 		for (int b = 0; b < 6; b++) {
 			mac48 = (mac48 << 8) | ll->addr[b];
 		}
+#if defined(CONFIG_SPINALI_COE_TX_NET_PKT)
+		memcpy(g_src_mac, ll->addr, NET_ETH_ADDR_LEN);
+#endif
 	} else {
 		LOG_ERR("interface MAC unavailable; stream IDs will not be unique");
 	}
@@ -693,11 +1209,12 @@ int main(void)
 	}
 
 	/*
-	 * Transmission and reception own separate sockets. A socket call holds
-	 * the lock of its file descriptor for the whole call, so a receive
-	 * blocked waiting for a packet would hold off every send issued on that
-	 * same descriptor until inbound traffic happened to release it, which
-	 * makes full duplex over one socket impossible.
+	 * On the net_pkt transmit path only reception goes through a socket.
+	 * On the socket path transmission and reception own separate sockets:
+	 * a socket call holds the lock of its file descriptor for the whole
+	 * call, so a receive blocked waiting for a packet would hold off every
+	 * send issued on that same descriptor until inbound traffic happened to
+	 * release it, which makes full duplex over one socket impossible.
 	 *
 	 * Only the receiving socket carries the AVTP ethertype. The
 	 * transmitting socket takes protocol 0, which inbound delivery never
@@ -713,32 +1230,35 @@ int main(void)
 		return 0;
 	}
 
+	struct sockaddr_ll local_rx = {
+		.sll_family = AF_PACKET,
+		.sll_protocol = htons(ETH_P_TSN),
+		.sll_ifindex = g_ifindex,
+	};
+
+	if (zsock_bind(g_sock_rx, (struct sockaddr *)&local_rx, sizeof(local_rx)) < 0) {
+		LOG_ERR("receive bind to interface %d failed: %d", g_ifindex, errno);
+		return 0;
+	}
+
+#if !defined(CONFIG_SPINALI_COE_TX_NET_PKT)
 	g_sock_tx = zsock_socket(AF_PACKET, SOCK_DGRAM, 0);
 	if (g_sock_tx < 0) {
 		LOG_ERR("transmit packet socket failed: %d", errno);
 		return 0;
 	}
 
-	struct sockaddr_ll local_rx = {
-		.sll_family = AF_PACKET,
-		.sll_protocol = htons(ETH_P_TSN),
-		.sll_ifindex = g_ifindex,
-	};
 	struct sockaddr_ll local_tx = {
 		.sll_family = AF_PACKET,
 		.sll_protocol = 0,
 		.sll_ifindex = g_ifindex,
 	};
 
-	if (zsock_bind(g_sock_rx, (struct sockaddr *)&local_rx, sizeof(local_rx)) < 0) {
-		LOG_ERR("receive bind to interface %d failed: %d", g_ifindex, errno);
-		return 0;
-	}
-
 	if (zsock_bind(g_sock_tx, (struct sockaddr *)&local_tx, sizeof(local_tx)) < 0) {
 		LOG_ERR("transmit bind to interface %d failed: %d", g_ifindex, errno);
 		return 0;
 	}
+#endif
 
 	bool started[COE_BUS_COUNT] = {false};
 
@@ -768,7 +1288,7 @@ int main(void)
 	/*
 	 * The catch-all receive filters come last, once the socket is open and
 	 * the transport threads are released: a filter installed any earlier
-	 * would fill the transport queue against gated consumers and shed
+	 * would fill the transport rings against gated consumers and shed
 	 * frames on a bus that is already busy at boot.
 	 */
 	for (uint8_t i = 0; i < COE_BUS_COUNT; i++) {
@@ -0,0 +1,58 @@
+# Copyright (c) 2026, CogniPilot Foundation
+# SPDX-License-Identifier: Apache-2.0
+"""
+Twister pytest harness for the zenoh bridge benchmark.
+
+Starts a zenohd on localhost, lets the native_sim bench connect to it, then
+measures with scripts/zenoh_bench_sub.py. The figures are recorded as test
+properties so that twister reports carry them from run to run; the test only
+fails if nothing gets through at all, or if loss exceeds ZENOH_BENCH_MAX_LOSS.
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import time
+from pathlib import Path
+
+import pytest
+
+sys.path.insert(0, str(Path(__file__).resolve().parents[3] / "scripts"))
+import zenoh_bench_sub  # noqa: E402
+
+LOCATOR = "tcp/127.0.0.1:7447"
+# the udp scenario's bridge connects here; the host subscriber stays on tcp
+UDP_LOCATOR = "udp/127.0.0.1:7447"
+DURATION_S = float(os.environ.get("ZENOH_BENCH_DURATION_S", "20"))
+MAX_LOSS = float(os.environ.get("ZENOH_BENCH_MAX_LOSS", "0.01"))
+
+
+@pytest.fixture
+def zenohd():
+    exe = shutil.which("zenohd")
+    if exe is None:
+        pytest.skip("zenohd not found on PATH")
+    proc = subprocess.Popen(
+        [exe, "--listen", LOCATOR, "--listen", UDP_LOCATOR, "--no-multicast-scouting"],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+    time.sleep(1.0)
+    yield proc
+    proc.terminate()
+    proc.wait(timeout=10)
+
+
+def test_zenoh_bench(zenohd, dut, record_property):
+    dut.readlines_until(regex="zenoh_bench: publishing", timeout=30)
+
+    summary = zenoh_bench_sub.run(LOCATOR, duration=DURATION_S, warmup=2.0)
+    zenoh_bench_sub.print_summary(summary)
+
+    for key, row in summary.items():
+        for metric in ("msgs_per_s", "bytes_per_s", "loss", "shed", "p50_us", "p99_us"):
+            record_property(f"{key}_{metric}", row[metric])
+
+    assert summary["total"]["messages"] > 0, "no samples reached the host"
+    assert summary["total"]["loss"] <= MAX_LOSS
@@ -0,0 +1,174 @@
+/*
+ * Copyright CogniPilot Foundation 2026
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Synthetic zros publisher for benchmarking the zenoh bridge on native_sim.
+ *
+ * Stands in for the sensor drivers: flow, IMU, GNSS and mag samples are
+ * published on the topics the bridge rows subscribe to, each stream at its
+ * configured rate. Every sample is stamped with the host's CLOCK_REALTIME,
+ * which the host subscriber shares, so the age it sees on arrival is the
+ * end-to-end latency through zros, the bridge, zenoh-pico and zenohd. Each
+ * stream also carries a sequence number in a field the bridge never looks at,
+ * from which the subscriber counts loss.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <native_rtc.h>
+
+#include <zros/private/zros_node_struct.h>
+#include <zros/private/zros_pub_struct.h>
+#include <zros/zros_node.h>
+#include <zros/zros_pub.h>
+
+#include <synapse_topic_list.h>
+
+LOG_MODULE_REGISTER(zenoh_bench, CONFIG_SPINALI_ZENOH_BENCH_LOG_LEVEL);
+
+enum bench_stream {
+	BENCH_FLOW,
+	BENCH_IMU,
+	BENCH_GNSS,
+	BENCH_MAG,
+	BENCH_STREAMS,
+};
+
+static const char *const stream_name[BENCH_STREAMS] = {"flow", "imu", "gnss", "mag"};
+
+static const uint32_t stream_rate[BENCH_STREAMS] = {
+	CONFIG_SPINALI_ZENOH_BENCH_FLOW_RATE,
+	CONFIG_SPINALI_ZENOH_BENCH_IMU_RATE,
+	CONFIG_SPINALI_ZENOH_BENCH_GNSS_RATE,
+	CONFIG_SPINALI_ZENOH_BENCH_MAG_RATE,
+};
+
+struct context {
+	struct zros_node node;
+	struct zros_pub pub[BENCH_STREAMS];
+	synapse_topic_OpticalFlowData_t flow;
+	synapse_topic_InertialSample_t imu;
+	synapse_topic_GnssFix_t gnss;
+	synapse_topic_MagneticField_t mag;
+	uint32_t sent[BENCH_STREAMS];
+};
+
+static struct context g_ctx;
+
+static uint64_t host_realtime_ns(void)
+{
+	return native_rtc_gettime_us(RTC_CLOCK_REALTIME) * NSEC_PER_USEC;
+}
+
+/* Stamp and publish the next sample of one stream. */
+static void bench_publish(struct context *ctx, enum bench_stream s)
+{
+	uint64_t now_ns = host_realtime_ns();
+	uint32_t seq = ctx->sent[s];
+
+	switch (s) {
+	case BENCH_FLOW:
+		ctx->flow.timestamp_ns = now_ns;
+		ctx->flow.error_count = seq;
+		break;
+	case BENCH_IMU:
+		ctx->imu.timestamp_ns = now_ns;
+		/* exact up to 2^24 samples, hours at any bench rate */
+		ctx->imu.temperature_c = (float)seq;
+		break;
+	case BENCH_GNSS:
+		ctx->gnss.timestamp_ns = now_ns;
+		ctx->gnss.time_unix_ns = seq;
+		break;
+	case BENCH_MAG:
+		ctx->mag.timestamp_ns = now_ns;
+		ctx->mag.temperature_c = (float)seq;
+		break;
+	default:
+		return;
+	}
+
+	zros_pub_update(&ctx->pub[s]);
+	ctx->sent[s]++;
+}
+
+static int bench_init(struct context *ctx)
+{
+	struct zros_topic *const topic[BENCH_STREAMS] = {
+		&topic_optical_flow,
+		&topic_imu0,
+		&topic_nav_sat_fix,
+		&topic_mag0,
+	};
+	void *const msg[BENCH_STREAMS] = {&ctx->flow, &ctx->imu, &ctx->gnss, &ctx->mag};
+
+	zros_node_init(&ctx->node, "zenoh_bench");
+
+	for (size_t s = 0; s < BENCH_STREAMS; s++) {
+		int ret = zros_pub_init(&ctx->pub[s], &ctx->node, topic[s], msg[s]);
+
+		if (ret < 0) {
+			LOG_ERR("init pub %s failed: %d", stream_name[s], ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	struct context *ctx = &g_ctx;
+	int64_t next[BENCH_STREAMS];
+	int64_t period[BENCH_STREAMS];
+	int64_t report_at;
+
+	if (bench_init(ctx) < 0) {
+		return 0;
+	}
+
+	for (size_t s = 0; s < BENCH_STREAMS; s++) {
+		period[s] = stream_rate[s] > 0
+				    ? (int64_t)k_us_to_ticks_near64(USEC_PER_SEC / stream_rate[s])
+				    : 0;
+		next[s] = k_uptime_ticks();
+		printk("zenoh_bench: %s at %u Hz\n", stream_name[s], stream_rate[s]);
+	}
+	report_at = k_uptime_ticks() + k_sec_to_ticks_near64(CONFIG_SPINALI_ZENOH_BENCH_REPORT_S);
+	printk("zenoh_bench: publishing\n");
+
+	for (;;) {
+		int64_t now = k_uptime_ticks();
+		int64_t wake = report_at;
+
+		for (size_t s = 0; s < BENCH_STREAMS; s++) {
+			if (period[s] == 0) {
+				continue;
+			}
+			if (next[s] <= now) {
+				bench_publish(ctx, (enum bench_stream)s);
+				next[s] += period[s];
+				/* after a late wake, resume the cadence rather than burst,
+				 * so every gap the subscriber sees is the bridge's
+				 */
+				if (next[s] <= now) {
+					next[s] = now + period[s];
+				}
+			}
+			wake = MIN(wake, next[s]);
+		}
+
+		if (now >= report_at) {
+			printk("zenoh_bench: sent flow=%u imu=%u gnss=%u mag=%u\n",
+			       ctx->sent[BENCH_FLOW], ctx->sent[BENCH_IMU], ctx->sent[BENCH_GNSS],
+			       ctx->sent[BENCH_MAG]);
+			report_at += k_sec_to_ticks_near64(CONFIG_SPINALI_ZENOH_BENCH_REPORT_S);
+			wake = MIN(wake, report_at);
+		}
+
+		k_sleep(K_TIMEOUT_ABS_TICKS(wake));
+	}
+
+	return 0;
+}
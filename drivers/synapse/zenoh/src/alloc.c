@@ -0,0 +1,222 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Allocation accounting for zenoh-pico.
+ *
+ * zenoh-pico routes every heap allocation through its platform functions
+ * z_malloc, z_realloc and z_free. The linker wraps those three (see
+ * CMakeLists.txt), so every call made from outside the platform translation
+ * unit lands here first, is counted, and is then passed on unchanged. The
+ * counters are what the zenoh shell turns into an allocation rate.
+ *
+ * With CONFIG_SPINALI_SYNAPSE_ZENOH_ARENA the calls are not passed on but
+ * served from a static arena of their own instead of the system heap, so
+ * zenoh-pico can neither fragment nor exhaust the heap that sensors and
+ * networking allocate from, and its peak use is measured rather than guessed.
+ *
+ * The wrap cannot reach calls made inside the platform translation unit
+ * itself, whose z_malloc and z_free go straight to k_malloc and k_free: its
+ * task and mutex helpers allocate from the system heap, and free with k_free
+ * blocks that may have come from the arena. So in arena mode every free is
+ * sent to the heap that owns the pointer, by address: the wrapped z_free and
+ * z_realloc pass a block from outside the arena on to the platform, and k_free
+ * is wrapped as well and hands an arena block back to the arena. Each block
+ * is freed into the heap it came from whichever path frees it; the few
+ * allocations made inside the platform unit are simply not in the arena.
+ */
+
+#include <stddef.h>
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ARENA)
+#include <zephyr/sys/sys_heap.h>
+#endif
+
+#include "alloc.h"
+
+void *__wrap_z_malloc(size_t size);
+void *__wrap_z_realloc(void *ptr, size_t size);
+void __wrap_z_free(void *ptr);
+void *__real_z_realloc(void *ptr, size_t size);
+void __real_z_free(void *ptr);
+
+static atomic_t g_allocs;
+static atomic_t g_frees;
+static atomic_t g_failures;
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ARENA)
+#define ARENA_SIZE CONFIG_SPINALI_SYNAPSE_ZENOH_ARENA_SIZE
+
+/*
+ * The arena is used from the bridge thread and, in a multi-thread build, from
+ * the zenoh read and lease tasks; one spinlock covers the heap and its
+ * watermark. Use is counted in usable bytes, what the heap actually hands
+ * out, so the peak is what the arena has to hold.
+ */
+static uint8_t g_arena[ARENA_SIZE] __aligned(8);
+static struct sys_heap g_heap;
+static struct k_spinlock g_lock;
+static size_t g_used;
+static size_t g_peak;
+static size_t g_largest_failure;
+
+void __wrap_k_free(void *ptr);
+void __real_k_free(void *ptr);
+
+static inline bool arena_owns(const void *ptr)
+{
+	return (const uint8_t *)ptr >= g_arena && (const uint8_t *)ptr < g_arena + sizeof(g_arena);
+}
+
+static void arena_free(void *ptr)
+{
+	k_spinlock_key_t key = k_spin_lock(&g_lock);
+
+	g_used -= sys_heap_usable_size(&g_heap, ptr);
+	sys_heap_free(&g_heap, ptr);
+	k_spin_unlock(&g_lock, key);
+}
+
+static void arena_account(void *ptr, size_t size, size_t released)
+{
+	if (ptr == NULL) {
+		g_largest_failure = MAX(g_largest_failure, size);
+		return;
+	}
+
+	g_used = g_used - released + sys_heap_usable_size(&g_heap, ptr);
+	g_peak = MAX(g_peak, g_used);
+}
+
+void *__wrap_z_malloc(size_t size)
+{
+	k_spinlock_key_t key = k_spin_lock(&g_lock);
+	void *ptr = sys_heap_alloc(&g_heap, size);
+
+	arena_account(ptr, size, 0);
+	k_spin_unlock(&g_lock, key);
+
+	atomic_inc(ptr != NULL ? &g_allocs : &g_failures);
+	return ptr;
+}
+
+void *__wrap_z_realloc(void *ptr, size_t size)
+{
+	if (ptr != NULL && !arena_owns(ptr)) {
+		/* allocated inside the platform unit, from the system heap */
+		return __real_z_realloc(ptr, size);
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&g_lock);
+	size_t held = ptr != NULL ? sys_heap_usable_size(&g_heap, ptr) : 0;
+	void *out = sys_heap_realloc(&g_heap, ptr, size);
+
+	if (out != NULL) {
+		arena_account(out, size, held);
+	} else if (size > 0) {
+		arena_account(NULL, size, 0);
+	} else {
+		g_used -= held;
+	}
+	k_spin_unlock(&g_lock, key);
+
+	if (out == NULL && size > 0) {
+		atomic_inc(&g_failures);
+	} else if (out != ptr) {
+		atomic_inc(&g_allocs);
+	}
+	return out;
+}
+
+void __wrap_z_free(void *ptr)
+{
+	if (ptr == NULL) {
+		return;
+	}
+
+	if (arena_owns(ptr)) {
+		arena_free(ptr);
+		atomic_inc(&g_frees);
+	} else {
+		/* allocated inside the platform unit, uncounted */
+		__real_z_free(ptr);
+	}
+}
+
+/* Catches arena blocks that the platform unit's own z_free hands to k_free. */
+void __wrap_k_free(void *ptr)
+{
+	if (ptr != NULL && arena_owns(ptr)) {
+		arena_free(ptr);
+	} else {
+		__real_k_free(ptr);
+	}
+}
+
+/* Before any session exists, so the first z_malloc finds the arena ready. */
+static int zenoh_arena_init(void)
+{
+	sys_heap_init(&g_heap, g_arena, sizeof(g_arena));
+	return 0;
+}
+
+SYS_INIT(zenoh_arena_init, PRE_KERNEL_1, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+
+#else /* CONFIG_SPINALI_SYNAPSE_ZENOH_ARENA */
+
+void *__real_z_malloc(size_t size);
+
+void *__wrap_z_malloc(size_t size)
+{
+	void *ptr = __real_z_malloc(size);
+
+	atomic_inc(ptr != NULL ? &g_allocs : &g_failures);
+	return ptr;
+}
+
+void *__wrap_z_realloc(void *ptr, size_t size)
+{
+	void *out = __real_z_realloc(ptr, size);
+
+	if (out == NULL && size > 0) {
+		atomic_inc(&g_failures);
+	} else if (out != ptr) {
+		atomic_inc(&g_allocs);
+	}
+	return out;
+}
+
+void __wrap_z_free(void *ptr)
+{
+	if (ptr != NULL) {
+		atomic_inc(&g_frees);
+	}
+	__real_z_free(ptr);
+}
+#endif /* CONFIG_SPINALI_SYNAPSE_ZENOH_ARENA */
+
+void zenoh_alloc_stats_get(struct zenoh_alloc_stats *stats)
+{
+	stats->allocs = (uint32_t)atomic_get(&g_allocs);
+	stats->frees = (uint32_t)atomic_get(&g_frees);
+	stats->failures = (uint32_t)atomic_get(&g_failures);
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ARENA)
+	k_spinlock_key_t key = k_spin_lock(&g_lock);
+
+	stats->arena_size = ARENA_SIZE;
+	stats->arena_used = g_used;
+	stats->arena_peak = g_peak;
+	stats->largest_failure = g_largest_failure;
+	k_spin_unlock(&g_lock, key);
+#else
+	stats->arena_size = 0;
+	stats->arena_used = 0;
+	stats->arena_peak = 0;
+	stats->largest_failure = 0;
+#endif
+}
+
+/* vi: ts=4 sw=4 et */
@@ -0,0 +1,29 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Allocation accounting for zenoh-pico, see alloc.c.
+ */
+
+#ifndef SYNAPSE_ZENOH_ALLOC_H
+#define SYNAPSE_ZENOH_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct zenoh_alloc_stats {
+	uint32_t allocs; /* z_malloc calls, plus z_realloc calls that moved or grew a block */
+	uint32_t frees; /* z_free calls on a non-NULL pointer */
+	uint32_t failures; /* allocations the platform allocator refused */
+	/* arena only, all zero when zenoh-pico allocates from the system heap */
+	size_t arena_size;
+	size_t arena_used; /* usable bytes of the blocks currently held */
+	size_t arena_peak; /* highest arena_used since boot */
+	size_t largest_failure; /* largest request the arena refused */
+};
+
+void zenoh_alloc_stats_get(struct zenoh_alloc_stats *stats);
+
+#endif /* SYNAPSE_ZENOH_ALLOC_H */
+
+/* vi: ts=4 sw=4 et */
@@ -0,0 +1,46 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Put attachment carried alongside every topic row payload.
+ *
+ * The attachment is this fixed-layout little-endian struct, sent as the
+ * Zenoh attachment of the put rather than inside the payload, so the value
+ * contracts and the payload layouts stay as the catalog defines them and a
+ * receiver that ignores attachments is unaffected.
+ *
+ * sequence counts the puts of a row from zero and wraps, the same count a
+ * batched row carries in its batch header: a gap is a put lost between the
+ * bridge and the receiver, while samples the row decimated, held back or
+ * never forwarded leave none. put_ns is the time of the put on the clock
+ * time_status names, the one the row's samples are stamped on, so put_ns
+ * minus a sample's timestamp_ns is the time the sample spent in the bridge,
+ * and, on a gPTP-disciplined receiver, its arrival minus put_ns the time it
+ * spent on the network.
+ */
+
+#ifndef SYNAPSE_ZENOH_ATTACHMENT_H
+#define SYNAPSE_ZENOH_ATTACHMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+struct synapse_zenoh_PutAttachment {
+	uint64_t put_ns;
+	uint32_t sequence;
+	uint8_t time_status; /* enum synapse_types_TimeStatus */
+	uint8_t reserved[3];
+};
+
+BUILD_ASSERT(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+
+BUILD_ASSERT(sizeof(struct synapse_zenoh_PutAttachment) == 16U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_PutAttachment, put_ns) == 0U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_PutAttachment, sequence) == 8U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_PutAttachment, time_status) == 12U);
+
+#endif /* SYNAPSE_ZENOH_ATTACHMENT_H */
+
+/* vi: ts=4 sw=4 et */
@@ -0,0 +1,48 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Batch framing for topic rows that pack several consecutive samples into one
+ * Zenoh put.
+ *
+ * A batched payload is this fixed-layout little-endian header followed by
+ * count samples of sample_size bytes each, laid out exactly as a single-sample
+ * put of the same row would carry them. The value contract of a batched row is
+ * the catalog contract of its sample type with SYNAPSE_ZENOH_BATCH_SUFFIX
+ * appended, so a receiver built for single samples rejects a batch by contract
+ * rather than misdecoding it.
+ *
+ * sequence counts puts per row from zero and wraps; a gap tells a receiver that
+ * whole batches were lost, as opposed to samples the row never forwarded.
+ */
+
+#ifndef SYNAPSE_ZENOH_BATCH_H
+#define SYNAPSE_ZENOH_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+struct synapse_zenoh_BatchHeader {
+	uint32_t sequence;
+	uint16_t count;
+	uint16_t sample_size;
+};
+
+#define SYNAPSE_ZENOH_BATCH_SUFFIX ";batch=synapse.zenoh.BatchHeader"
+
+/*
+ * The header keeps the 8-byte alignment the sample structs are laid out for,
+ * so every sample in a batch sits at the same alignment as in a single put.
+ */
+BUILD_ASSERT(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+
+BUILD_ASSERT(sizeof(struct synapse_zenoh_BatchHeader) == 8U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_BatchHeader, sequence) == 0U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_BatchHeader, count) == 4U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_BatchHeader, sample_size) == 6U);
+
+#endif /* SYNAPSE_ZENOH_BATCH_H */
+
+/* vi: ts=4 sw=4 et */
@@ -0,0 +1,208 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Compact quantized payloads.
+ *
+ * The encoders work in the row's payload slot, so a compact put is sent by
+ * reference like any other. They read the batch twice: once for the largest
+ * magnitude of every vector group and the longest gap between timestamps,
+ * which fix the scales and the dt tick, and once to write the compact
+ * samples over it from the front. A compact sample is shorter than the struct
+ * it encodes and the compact header no longer than the batch header plus one
+ * struct, so every write lands on bytes that have already been read.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include <synapse_topic_list.h>
+
+#include "batch.h"
+#include "compact.h"
+
+BUILD_ASSERT(sizeof(struct synapse_zenoh_CompactInertialSample) <=
+	     sizeof(synapse_topic_InertialSample_t));
+BUILD_ASSERT(sizeof(struct synapse_zenoh_CompactHeader) +
+		     sizeof(struct synapse_zenoh_CompactInertialSample) <=
+	     sizeof(struct synapse_zenoh_BatchHeader) + sizeof(synapse_topic_InertialSample_t));
+BUILD_ASSERT(sizeof(struct synapse_zenoh_CompactMagneticSample) <=
+	     sizeof(synapse_topic_MagneticField_t));
+BUILD_ASSERT(sizeof(struct synapse_zenoh_CompactHeader) +
+		     sizeof(struct synapse_zenoh_CompactMagneticSample) <=
+	     sizeof(struct synapse_zenoh_BatchHeader) + sizeof(synapse_topic_MagneticField_t));
+
+/* Delta coder state: the decoded time of the last sample, and the tick. */
+struct dt_coder {
+	uint64_t decoded_ns;
+	uint32_t unit_ns;
+};
+
+/*
+ * The tick is picked so the longest gap takes at most UINT8_MAX - 1 ticks;
+ * with the half tick the decoded time may trail by, every dt fits a byte.
+ */
+static void dt_coder_init(struct dt_coder *dc, uint64_t first_ns, uint64_t max_gap_ns)
+{
+	uint64_t unit_ns = DIV_ROUND_UP(max_gap_ns, UINT8_MAX - 1U);
+
+	dc->decoded_ns = first_ns;
+	dc->unit_ns = (uint32_t)CLAMP(unit_ns, 1U, UINT32_MAX);
+}
+
+static uint8_t dt_encode(struct dt_coder *dc, uint64_t timestamp_ns)
+{
+	uint64_t ticks = 0;
+
+	if (timestamp_ns > dc->decoded_ns) {
+		ticks = (timestamp_ns - dc->decoded_ns + dc->unit_ns / 2U) / dc->unit_ns;
+		ticks = MIN(ticks, UINT8_MAX);
+	}
+
+	dc->decoded_ns += ticks * dc->unit_ns;
+	return (uint8_t)ticks;
+}
+
+static void vec_max(float *max, const synapse_types_Vec3f_t *v)
+{
+	const float c[3] = {v->x, v->y, v->z};
+
+	for (size_t i = 0; i < ARRAY_SIZE(c); i++) {
+		if (isfinite(c[i])) {
+			*max = MAX(*max, fabsf(c[i]));
+		}
+	}
+}
+
+static float vec_scale(float max)
+{
+	return max > 0.0f ? max / INT16_MAX : 0.0f;
+}
+
+static void vec_quantize(int16_t out[3], const synapse_types_Vec3f_t *v, float scale)
+{
+	const float c[3] = {v->x, v->y, v->z};
+
+	for (size_t i = 0; i < ARRAY_SIZE(c); i++) {
+		if (scale == 0.0f || !isfinite(c[i])) {
+			out[i] = 0;
+			continue;
+		}
+		out[i] = (int16_t)CLAMP(lrintf(c[i] / scale), -INT16_MAX, INT16_MAX);
+	}
+}
+
+static int16_t centi_celsius(float temperature_c)
+{
+	if (!isfinite(temperature_c)) {
+		return INT16_MIN;
+	}
+
+	return (int16_t)lrintf(CLAMP(temperature_c * 100.0f, -INT16_MAX, INT16_MAX));
+}
+
+size_t synapse_zenoh_compact_imu(uint8_t *slot, size_t count, uint32_t sequence)
+{
+	const uint8_t *in = slot + sizeof(struct synapse_zenoh_BatchHeader);
+	uint8_t *out = slot + sizeof(struct synapse_zenoh_CompactHeader);
+	struct synapse_zenoh_CompactHeader hdr = {
+		.sequence = sequence,
+		.count = (uint16_t)count,
+		.sample_size = sizeof(struct synapse_zenoh_CompactInertialSample),
+		.temperature_cc = INT16_MIN,
+	};
+	synapse_topic_InertialSample_t s;
+	uint64_t last_ns = 0; /* latest timestamp so far */
+	uint64_t max_gap_ns = 0;
+	float accel_max = 0.0f;
+	float gyro_max = 0.0f;
+	struct dt_coder dc;
+
+	for (size_t n = 0; n < count; n++) {
+		memcpy(&s, in + n * sizeof(s), sizeof(s));
+		if (n == 0) {
+			hdr.timestamp_ns = s.timestamp_ns;
+			hdr.time_status = s.time_status;
+			hdr.id = s.id;
+			last_ns = s.timestamp_ns;
+		} else if (s.timestamp_ns > last_ns) {
+			max_gap_ns = MAX(max_gap_ns, s.timestamp_ns - last_ns);
+			last_ns = s.timestamp_ns;
+		}
+		vec_max(&accel_max, &s.accel_flu_m_s2);
+		vec_max(&gyro_max, &s.gyro_flu_rad_s);
+		hdr.temperature_cc = centi_celsius(s.temperature_c);
+	}
+
+	hdr.scale[0] = vec_scale(accel_max);
+	hdr.scale[1] = vec_scale(gyro_max);
+	dt_coder_init(&dc, hdr.timestamp_ns, max_gap_ns);
+	hdr.dt_unit_ns = dc.unit_ns;
+
+	for (size_t n = 0; n < count; n++) {
+		struct synapse_zenoh_CompactInertialSample c;
+
+		memcpy(&s, in + n * sizeof(s), sizeof(s));
+		c.dt = dt_encode(&dc, s.timestamp_ns);
+		c.flags = s.flags;
+		vec_quantize(c.accel_flu, &s.accel_flu_m_s2, hdr.scale[0]);
+		vec_quantize(c.gyro_flu, &s.gyro_flu_rad_s, hdr.scale[1]);
+		memcpy(out + n * sizeof(c), &c, sizeof(c));
+	}
+
+	memcpy(slot, &hdr, sizeof(hdr));
+	return sizeof(hdr) + count * sizeof(struct synapse_zenoh_CompactInertialSample);
+}
+
+size_t synapse_zenoh_compact_mag(uint8_t *slot, size_t count, uint32_t sequence)
+{
+	const uint8_t *in = slot + sizeof(struct synapse_zenoh_BatchHeader);
+	uint8_t *out = slot + sizeof(struct synapse_zenoh_CompactHeader);
+	struct synapse_zenoh_CompactHeader hdr = {
+		.sequence = sequence,
+		.count = (uint16_t)count,
+		.sample_size = sizeof(struct synapse_zenoh_CompactMagneticSample),
+		.temperature_cc = INT16_MIN,
+	};
+	synapse_topic_MagneticField_t s;
+	uint64_t last_ns = 0; /* latest timestamp so far */
+	uint64_t max_gap_ns = 0;
+	float field_max = 0.0f;
+	struct dt_coder dc;
+
+	for (size_t n = 0; n < count; n++) {
+		memcpy(&s, in + n * sizeof(s), sizeof(s));
+		if (n == 0) {
+			hdr.timestamp_ns = s.timestamp_ns;
+			hdr.time_status = s.time_status;
+			hdr.id = s.id;
+			last_ns = s.timestamp_ns;
+		} else if (s.timestamp_ns > last_ns) {
+			max_gap_ns = MAX(max_gap_ns, s.timestamp_ns - last_ns);
+			last_ns = s.timestamp_ns;
+		}
+		vec_max(&field_max, &s.mag_flu_tesla);
+		hdr.temperature_cc = centi_celsius(s.temperature_c);
+	}
+
+	hdr.scale[0] = vec_scale(field_max);
+	dt_coder_init(&dc, hdr.timestamp_ns, max_gap_ns);
+	hdr.dt_unit_ns = dc.unit_ns;
+
+	for (size_t n = 0; n < count; n++) {
+		struct synapse_zenoh_CompactMagneticSample c;
+
+		memcpy(&s, in + n * sizeof(s), sizeof(s));
+		c.dt = dt_encode(&dc, s.timestamp_ns);
+		c.flags = s.flags;
+		vec_quantize(c.mag_flu, &s.mag_flu_tesla, hdr.scale[0]);
+		memcpy(out + n * sizeof(c), &c, sizeof(c));
+	}
+
+	memcpy(slot, &hdr, sizeof(hdr));
+	return sizeof(hdr) + count * sizeof(struct synapse_zenoh_CompactMagneticSample);
+}
+
+/* vi: ts=4 sw=4 et */
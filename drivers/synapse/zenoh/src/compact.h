@@ -0,0 +1,100 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Compact quantized payloads for the high-rate inertial and magnetometer
+ * rows, see compact.c.
+ *
+ * A compact payload is this fixed-layout little-endian header followed by
+ * count samples of sample_size bytes each. It replaces a whole batch of the
+ * row's catalog structs and goes out under its own value contract, so a
+ * receiver built for the catalog structs or for plain batches rejects it by
+ * contract rather than misdecoding it.
+ *
+ * Vectors are int16 fixed point on a per-batch scale: a component decodes as
+ * its integer times the scale of its group, and the scale is chosen so the
+ * largest magnitude in the batch maps to 32767. A component that was not
+ * finite is sent as 0. Timestamps are delta coded: the first sample's time is
+ * timestamp_ns, and every sample's dt counts dt_unit_ns ticks from the time
+ * decoded for the sample before it, so the decoded times stay within half a
+ * tick of the originals however long the batch. A sample stamped earlier than
+ * the one before it decodes at the same time. temperature_cc is the last
+ * sample's temperature in hundredths of a degree Celsius, INT16_MIN when it
+ * was not finite. sequence is the row's put count, as in the batch header.
+ */
+
+#ifndef SYNAPSE_ZENOH_COMPACT_H
+#define SYNAPSE_ZENOH_COMPACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+struct synapse_zenoh_CompactHeader {
+	uint64_t timestamp_ns;
+	uint32_t dt_unit_ns;
+	uint32_t sequence;
+	uint16_t count;
+	uint16_t sample_size;
+	float scale[2]; /* per group, see the sample structs */
+	int16_t temperature_cc;
+	uint8_t time_status; /* enum synapse_types_TimeStatus */
+	uint8_t id;
+};
+
+/* scale[0] is m/s^2 per accel count, scale[1] rad/s per gyro count. */
+struct synapse_zenoh_CompactInertialSample {
+	int16_t accel_flu[3];
+	int16_t gyro_flu[3];
+	uint8_t dt;
+	uint8_t flags; /* enum synapse_topic_InertialFieldFlags */
+};
+
+/* scale[0] is tesla per count; scale[1] is unused and sent as 0. */
+struct synapse_zenoh_CompactMagneticSample {
+	int16_t mag_flu[3];
+	uint8_t dt;
+	uint8_t flags; /* enum synapse_topic_MagFieldFlags */
+};
+
+#define SYNAPSE_ZENOH_COMPACT_IMU_CONTRACT                                                         \
+	"application/x-synapse-struct;type=synapse.zenoh.CompactInertialBatch;version=1"
+#define SYNAPSE_ZENOH_COMPACT_MAG_CONTRACT                                                         \
+	"application/x-synapse-struct;type=synapse.zenoh.CompactMagneticBatch;version=1"
+
+/*
+ * Rewrite, in place, the count catalog structs that follow the batch header
+ * in slot as one compact payload starting at slot, and return its length.
+ * The compact payload is never longer than the batch it replaces.
+ */
+size_t synapse_zenoh_compact_imu(uint8_t *slot, size_t count, uint32_t sequence);
+size_t synapse_zenoh_compact_mag(uint8_t *slot, size_t count, uint32_t sequence);
+
+BUILD_ASSERT(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+
+BUILD_ASSERT(sizeof(struct synapse_zenoh_CompactHeader) == 32U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, timestamp_ns) == 0U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, dt_unit_ns) == 8U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, sequence) == 12U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, count) == 16U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, sample_size) == 18U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, scale) == 20U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, temperature_cc) == 28U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, time_status) == 30U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactHeader, id) == 31U);
+
+BUILD_ASSERT(sizeof(struct synapse_zenoh_CompactInertialSample) == 14U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactInertialSample, accel_flu) == 0U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactInertialSample, gyro_flu) == 6U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactInertialSample, dt) == 12U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactInertialSample, flags) == 13U);
+
+BUILD_ASSERT(sizeof(struct synapse_zenoh_CompactMagneticSample) == 8U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactMagneticSample, mag_flu) == 0U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactMagneticSample, dt) == 6U);
+BUILD_ASSERT(offsetof(struct synapse_zenoh_CompactMagneticSample, flags) == 7U);
+
+#endif /* SYNAPSE_ZENOH_COMPACT_H */
+
+/* vi: ts=4 sw=4 et */
@@ -0,0 +1,58 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Power-of-two histogram of microsecond values for the bridge statistics.
+ *
+ * Bucket 0 holds zero, bucket b holds [2^(b-1), 2^b) and the last bucket holds
+ * everything from 2^(HIST_BUCKETS-2) up, so twenty buckets resolve from a
+ * microsecond to a quarter second before saturating. Recording is a find-msb
+ * and an increment, cheap enough for the publish path.
+ */
+
+#ifndef SYNAPSE_ZENOH_HIST_H
+#define SYNAPSE_ZENOH_HIST_H
+
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#define HIST_BUCKETS 20
+
+struct hist {
+	uint32_t bucket[HIST_BUCKETS];
+	uint32_t max;
+};
+
+static inline void hist_record(struct hist *h, uint32_t value)
+{
+	h->bucket[MIN(find_msb_set(value), HIST_BUCKETS - 1U)]++;
+	h->max = MAX(h->max, value);
+}
+
+/* Lower bound of a bucket, in the recorded unit. */
+static inline uint32_t hist_bucket_floor(unsigned int b)
+{
+	return b == 0U ? 0U : BIT(b - 1U);
+}
+
+/* Print the non-empty buckets of a histogram on one line each. */
+static inline void hist_print(const struct shell *sh, const char *name, const struct hist *h)
+{
+	shell_print(sh, "  %s (max %u us):", name, h->max);
+	for (unsigned int b = 0; b < HIST_BUCKETS; b++) {
+		if (h->bucket[b] == 0U) {
+			continue;
+		}
+		if (b == HIST_BUCKETS - 1U) {
+			shell_print(sh, "    >= %7u us: %u", hist_bucket_floor(b), h->bucket[b]);
+		} else {
+			shell_print(sh, "    <  %7u us: %u", hist_bucket_floor(b + 1U), h->bucket[b]);
+		}
+	}
+}
+
+#endif /* SYNAPSE_ZENOH_HIST_H */
+
+/* vi: ts=4 sw=4 et */
@@ -8,15 +8,29 @@
  * contract for their type. A receiver matches that contract string before it
  * decodes anything, so key, media type, wire type and schema hash all have to
  * agree with the catalog entry the receiver was built against.
+ *
+ * Inbound keys are bound the same way, through inbound_table, and are checked
+ * against their contract before they are republished on zros.
  */
 
 #include <errno.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#if defined(CONFIG_PTP_CLOCK)
+#include <zephyr/drivers/ptp_clock.h>
+#include <zephyr/net/ethernet.h>
+#include <zephyr/net/net_if.h>
+#endif
+#if defined(CONFIG_STATS)
+#include <zephyr/stats/stats.h>
+#endif
 
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_pub_struct.h>
@@ -27,8 +41,26 @@
 
 #include <zenoh-pico.h>
 
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_CMD_VEL_SUB) ||                                           \
+	defined(CONFIG_SPINALI_SYNAPSE_ZENOH_BEZIER_TRAJECTORY_SUB) ||                             \
+	defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ODOMETRY_SUB)
+#include <pb_decode.h>
+#endif
+
 #include <synapse_topic_list.h>
 
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ALLOC_STATS)
+#include "alloc.h"
+#endif
+#include "attachment.h"
+#include "batch.h"
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_IMU_COMPACT) ||                                          \
+	defined(CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_COMPACT)
+#include "compact.h"
+#endif
+#include "hist.h"
+#include "rtcm3.h"
+
 LOG_MODULE_REGISTER(synapse_zenoh, CONFIG_SPINALI_SYNAPSE_ZENOH_LOG_LEVEL);
 
 #define MY_STACK_SIZE 8192
@@ -36,12 +68,229 @@ LOG_MODULE_REGISTER(synapse_zenoh, CONFIG_SPINALI_SYNAPSE_ZENOH_LOG_LEVEL);
 
 #define KEYEXPR_MAX 96
 
+/*
+ * Payload slots per topic row. With zero-copy publishing a row cycles through
+ * a small ring of slots, one of which zros writes the next sample into while
+ * zenoh may still hold the others; without it a single buffer suffices,
+ * because every sample is copied out before the next one lands.
+ */
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ZERO_COPY)
+#define PAYLOAD_SLOTS CONFIG_SPINALI_SYNAPSE_ZENOH_PAYLOAD_SLOTS
+#else
+#define PAYLOAD_SLOTS 1
+#endif
+
+/* Window over which the row and zenoh-pico allocation rates are measured. */
+#define RATE_WINDOW_MS 1000
+
+/*
+ * Row rate that forwards every sample. zros limits a subscription to the rate
+ * it is given, so every sample means asking for the finest period the kernel
+ * clock can tell apart.
+ */
+#define RATE_EVERY_SAMPLE 0
+
+/*
+ * Longest the run loop waits for a sample when no batch is pending. A
+ * single-thread build also services zenoh from this loop, so it waits no
+ * longer than the spin period.
+ */
+#if Z_FEATURE_MULTI_THREAD == 1
+#define POLL_TIMEOUT_MS 1000
+#else
+#define POLL_TIMEOUT_MS CONFIG_SPINALI_SYNAPSE_ZENOH_SPIN_PERIOD_MS
+#endif
+
+/*
+ * Last-value cache. Every row keeps its latest sample and answers queries on
+ * its own key with it, so a late joiner has state without waiting for the
+ * next put.
+ */
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_LAST_VALUE) && Z_FEATURE_QUERYABLE == 1
+#define SYNAPSE_ZENOH_LAST_VALUE 1
+#else
+#define SYNAPSE_ZENOH_LAST_VALUE 0
+#endif
+
+/*
+ * Matching. A row no subscriber matches still takes its samples from zros,
+ * so the poll set stays quiet and the last-value cache current, but copies
+ * and puts none of them until zenoh's matching listener reports a match.
+ */
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SKIP_UNMATCHED) && Z_FEATURE_MATCHING == 1
+#define SYNAPSE_ZENOH_MATCHING 1
+#else
+#define SYNAPSE_ZENOH_MATCHING 0
+#endif
+
+/*
+ * Liveliness. The board declares a token on its namespace, or on
+ * LIVELINESS_NODE_KEY without one, for as long as its session is up, and
+ * optionally one per row on the row's key while the row is on; a host that
+ * watches them learns of a dead or restarted board within the lease instead
+ * of from a data timeout.
+ */
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_LIVELINESS) && Z_FEATURE_LIVELINESS == 1
+#define SYNAPSE_ZENOH_LIVELINESS 1
+#define LIVELINESS_NODE_KEY      "spinali"
+#else
+#define SYNAPSE_ZENOH_LIVELINESS 0
+#endif
+
+/*
+ * Load shedding. Every SHED_PERIOD_MS the run loop judges the link by the
+ * puts of the period: a failed put, a mean put duration above SHED_PUT_US or
+ * a row that found all its payload slots still lent to zenoh makes the
+ * period congested and raises the shed level by one, up to SHED_LEVEL_MAX;
+ * SHED_RECOVER_PERIODS clear periods in a row lower it by one. At level L a
+ * row of shed rank r, 0 < r <= L, puts one sample in 2^(L - r + 1); rank 0
+ * rows are never shed.
+ */
+#define SHED_LEVEL_MAX 4
+
+/*
+ * Publish-on-change. A row with a change test puts a sample only when it
+ * differs from the last one it let through by more than the row's deadband,
+ * or when that one is older than the row's heartbeat, so a slowly varying
+ * row costs a put per heartbeat while it holds still.
+ */
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_GNSS_ON_CHANGE) ||                                        \
+	defined(CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_ON_CHANGE)
+#define SYNAPSE_ZENOH_ON_CHANGE 1
+#else
+#define SYNAPSE_ZENOH_ON_CHANGE 0
+#endif
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_GNSS_ON_CHANGE)
+#define GNSS_CHANGED      gnss_changed
+#define GNSS_HEARTBEAT_MS CONFIG_SPINALI_SYNAPSE_ZENOH_GNSS_HEARTBEAT_MS
+#else
+#define GNSS_CHANGED      NULL
+#define GNSS_HEARTBEAT_MS 0
+#endif
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_ON_CHANGE)
+#define MAG_CHANGED      mag_changed
+#define MAG_HEARTBEAT_MS CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_HEARTBEAT_MS
+#else
+#define MAG_CHANGED      NULL
+#define MAG_HEARTBEAT_MS 0
+#endif
+
+/*
+ * Consecutive put or spin failures after which the session is taken for lost
+ * even though zenoh-pico has not closed it yet, e.g. while a dead TCP link is
+ * still inside its lease.
+ */
+#define SESSION_LOST_ERRORS 3
+
+/*
+ * Samples per put and flush deadline of the rows that support batching. The
+ * latency options only exist while their row batches.
+ */
+#define IMU_BATCH CONFIG_SPINALI_SYNAPSE_ZENOH_IMU_BATCH
+#define MAG_BATCH CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_BATCH
+
+#if IMU_BATCH > 1
+#define IMU_BATCH_LATENCY_MS CONFIG_SPINALI_SYNAPSE_ZENOH_IMU_BATCH_LATENCY_MS
+#else
+#define IMU_BATCH_LATENCY_MS 0
+#endif
+
+/* Rows that put their batches in the compact layout, see src/compact.h. */
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_IMU_COMPACT)
+#define IMU_ENCODER (&imu_compact_encoder)
+#else
+#define IMU_ENCODER NULL
+#endif
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_COMPACT)
+#define MAG_ENCODER (&mag_compact_encoder)
+#else
+#define MAG_ENCODER NULL
+#endif
+
+#if MAG_BATCH > 1
+#define MAG_BATCH_LATENCY_MS CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_BATCH_LATENCY_MS
+#else
+#define MAG_BATCH_LATENCY_MS 0
+#endif
+
+/*
+ * Bytes in one payload slot of a row: a single sample struct, or on a batched
+ * row the batch header followed by room for batch samples.
+ */
+#define ROW_SLOT_SIZE(type, batch)                                                                 \
+	((batch) > 1 ? sizeof(struct synapse_zenoh_BatchHeader) + (size_t)(batch) * sizeof(type)   \
+		     : sizeof(type))
+
+/* Value contract of a row; a batched row says so. */
+#define ROW_CONTRACT(contract, batch) ((batch) > 1 ? contract SYNAPSE_ZENOH_BATCH_SUFFIX : contract)
+
+/*
+ * The outbound rows this build carries, one X(...) per row enabled in
+ * Kconfig: payload buffer name, zros topic, sample type, key, contract, rate,
+ * batch, batch latency, priority, congestion control, express flag, shed rank,
+ * change test, heartbeat and encoder. A row that is switched off leaves no buffer,
+ * subscription or poll event behind.
+ * Further instances of a sensor share its class settings under their own key.
+ */
+#define ZENOH_ROWS(X)                                                                              \
+	IF_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ROW_FLOW,                                          \
+		   (X(flow, optical_flow, synapse_topic_OpticalFlowData_t,                         \
+		      SYNAPSE_TOPIC_OPTICAL_FLOW_KEY, SYNAPSE_TOPIC_OPTICAL_FLOW_CONTRACT,         \
+		      CONFIG_SPINALI_SYNAPSE_ZENOH_FLOW_RATE, 1, 0, Z_PRIORITY_INTERACTIVE_HIGH,   \
+		      Z_CONGESTION_CONTROL_DROP, true, 3, NULL, 0, NULL)))                        \
+	IF_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ROW_FLOW_VEL,                                      \
+		   (X(flow_vel, optical_flow_vel, synapse_topic_OpticalFlowVelocityData_t,         \
+		      SYNAPSE_TOPIC_OPTICAL_FLOW_VELOCITY_KEY,                                     \
+		      SYNAPSE_TOPIC_OPTICAL_FLOW_VELOCITY_CONTRACT,                                \
+		      CONFIG_SPINALI_SYNAPSE_ZENOH_FLOW_VEL_RATE, 1, 0,                            \
+		      Z_PRIORITY_INTERACTIVE_HIGH, Z_CONGESTION_CONTROL_DROP, true, 2, NULL, 0,   \
+		      NULL)))                                                                      \
+	IF_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ROW_GNSS,                                          \
+		   (X(gnss, nav_sat_fix, synapse_topic_GnssFix_t, SYNAPSE_TOPIC_GNSS_KEY,          \
+		      SYNAPSE_TOPIC_GNSS_CONTRACT, CONFIG_SPINALI_SYNAPSE_ZENOH_GNSS_RATE, 1, 0,   \
+		      Z_PRIORITY_DATA_HIGH, Z_CONGESTION_CONTROL_BLOCK, false, 0, GNSS_CHANGED,    \
+		      GNSS_HEARTBEAT_MS, NULL)))                                                   \
+	IF_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ROW_IMU0, (IMU_ROW(X, imu0, "")))                  \
+	IF_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ROW_IMU1, (IMU_ROW(X, imu1, "1")))                 \
+	IF_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ROW_IMU2, (IMU_ROW(X, imu2, "2")))                 \
+	IF_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ROW_MAG0, (MAG_ROW(X, mag0, "")))                  \
+	IF_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ROW_MAG1, (MAG_ROW(X, mag1, "1")))
+
+/* Instance 0 keeps the bare catalog key; instance n publishes as <key>n. */
+#define IMU_ROW(X, instance, suffix)                                                               \
+	X(instance, instance, synapse_topic_InertialSample_t, SYNAPSE_TOPIC_IMU_KEY suffix,        \
+	  SYNAPSE_TOPIC_IMU_CONTRACT, CONFIG_SPINALI_SYNAPSE_ZENOH_IMU_RATE, IMU_BATCH,            \
+	  IMU_BATCH_LATENCY_MS, Z_PRIORITY_REAL_TIME, Z_CONGESTION_CONTROL_DROP, IMU_BATCH == 1,   \
+	  0, NULL, 0, IMU_ENCODER)
+
+#define MAG_ROW(X, instance, suffix)                                                               \
+	X(instance, instance, synapse_topic_MagneticField_t, SYNAPSE_TOPIC_MAG_KEY suffix,         \
+	  SYNAPSE_TOPIC_MAG_CONTRACT, CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_RATE, MAG_BATCH,            \
+	  MAG_BATCH_LATENCY_MS, Z_PRIORITY_DATA, Z_CONGESTION_CONTROL_DROP, false, 1, MAG_CHANGED, \
+	  MAG_HEARTBEAT_MS, MAG_ENCODER)
+
+#define ROW_BUFFER(name, zros_topic, type, key, contract, hz, batch, ...)                         \
+	uint8_t name[PAYLOAD_SLOTS * ROW_SLOT_SIZE(type, batch)] __aligned(8);                     \
+	IF_ENABLED(SYNAPSE_ZENOH_LAST_VALUE, (uint8_t name##_last[sizeof(type)] __aligned(8);))    \
+	IF_ENABLED(SYNAPSE_ZENOH_ON_CHANGE, (uint8_t name##_sent[sizeof(type)] __aligned(8);))
+
+#define ROW_SAMPLE_MEMBER(name, zros_topic, type, ...) type name;
+
+/* Room for one sample of any row. */
+union row_sample_any {
+	ZENOH_ROWS(ROW_SAMPLE_MEMBER)
+};
+
 /*
  * Inbound RTCM3 corrections. Only a node that forwards corrections to a GNSS
  * receiver (CONFIG_ZROS_SENSE_RTCM3_SUB) wants this path, and it needs the
- * zenoh subscription feature compiled in. The wire payload is the raw
- * variable-length RTCM3 byte stream (no fixed-layout struct, no value
- * contract), so the driver republishes it verbatim on topic_rtcm3.
+ * zenoh subscription feature compiled in. The wire payload is the raw RTCM3
+ * byte stream (no fixed-layout struct, no value contract), with no promise
+ * that a sample boundary falls on a frame boundary, so the driver reframes it
+ * before republishing on topic_rtcm3.
  */
 #if defined(CONFIG_ZROS_SENSE_RTCM3_SUB) && Z_FEATURE_SUBSCRIPTION == 1
 #define SYNAPSE_ZENOH_RTCM3_INBOUND 1
@@ -50,25 +299,100 @@ LOG_MODULE_REGISTER(synapse_zenoh, CONFIG_SPINALI_SYNAPSE_ZENOH_LOG_LEVEL);
 #define SYNAPSE_ZENOH_RTCM3_INBOUND 0
 #endif
 
+/*
+ * Inbound rows, commands and references a ground station or companion sends
+ * the board. Their zros types are nanopb messages rather than fixed-layout
+ * structs, so the wire value is the protobuf encoding, tagged with a
+ * protobuf contract naming the message.
+ */
+#if Z_FEATURE_SUBSCRIPTION == 1 &&                                                                 \
+	(defined(CONFIG_SPINALI_SYNAPSE_ZENOH_CMD_VEL_SUB) ||                                      \
+	 defined(CONFIG_SPINALI_SYNAPSE_ZENOH_BEZIER_TRAJECTORY_SUB) ||                            \
+	 defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ODOMETRY_SUB))
+#define SYNAPSE_ZENOH_INBOUND 1
+#else
+#define SYNAPSE_ZENOH_INBOUND 0
+#endif
+
+#define SYNAPSE_PB_CONTRACT(message) "application/protobuf;synapse_pb." message
+
 static K_THREAD_STACK_DEFINE(g_my_stack_area, MY_STACK_SIZE);
 
+/*
+ * Latency from the arrival of an inbound sample to its zros publication. In a
+ * multi-thread build the read task runs the handler on arrival, so this is the
+ * handler itself. In a single-thread build the sample arrived at some point
+ * after the previous zp_spin_once drained the link, so the time since then is
+ * the worst case it can have waited and is what gets recorded.
+ */
+struct inbound_latency {
+	uint32_t count;
+	uint32_t last_us;
+	uint32_t max_us;
+};
+
 struct context {
 	struct zros_node node;
-	/* topic data, pointed to by the topic table rows below */
-	synapse_topic_OpticalFlowData_t flow;
-	synapse_topic_OpticalFlowVelocityData_t flow_vel;
-	synapse_topic_GnssFix_t gnss;
-	synapse_topic_InertialSample_t imu;
-	synapse_topic_MagneticField_t mag;
+	/* topic payload slots, pointed to by the topic table rows below */
+	ZENOH_ROWS(ROW_BUFFER)
 #if SYNAPSE_ZENOH_RTCM3_INBOUND
 	/* inbound RTCM3 correction bytes, republished on topic_rtcm3 */
 	synapse_pb_Rtcm3 rtcm3;
+#endif
+	/* inbound messages, decoded in place and republished */
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_CMD_VEL_SUB)
+	synapse_pb_Twist cmd_vel;
+#endif
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_BEZIER_TRAJECTORY_SUB)
+	synapse_pb_BezierTrajectory bezier_trajectory;
+#endif
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ODOMETRY_SUB)
+	synapse_pb_Odometry odometry;
 #endif
 	/* zenoh */
 	z_owned_session_t session;
+	bool session_open;
+	/* supervisor */
+	uint32_t link_errors; /* consecutive put or spin failures */
+	uint32_t reconnects;
+	uint32_t backoff_ms;
+	int64_t reconnect_at_ms;
+	int64_t lost_at_ms;
+	int64_t opened_at_ms;
+	bool first_put_pending;
+	uint32_t last_outage_ms; /* loss detected to session reopened */
+	uint32_t last_first_put_ms; /* session reopened to first sample put */
 #if SYNAPSE_ZENOH_RTCM3_INBOUND
 	z_owned_subscriber_t rtcm3_reader;
+	struct rtcm3_framer rtcm3_framer;
 	struct zros_pub pub_rtcm3;
+	struct inbound_latency rtcm3_latency;
+#endif
+#if Z_FEATURE_MULTI_THREAD == 0
+	/* cycle count when zp_spin_once last returned, having drained the link */
+	uint32_t spin_done_cyc;
+#endif
+	/* raised to get the run loop out of k_poll, e.g. on stop */
+	struct k_poll_signal wake;
+#if defined(CONFIG_PTP_CLOCK)
+	/* PHC that timestamps GptpSynced and GptpHoldover payloads, or NULL */
+	const struct device *phc;
+#endif
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+	/* load shedding, judged over the current period */
+	uint8_t shed_level;
+	uint16_t shed_clear_periods;
+	int64_t shed_period_start_ms;
+	uint32_t shed_puts;
+	uint32_t shed_put_errors;
+	uint32_t shed_backlog; /* claims that found every slot lent */
+	uint64_t shed_put_us;
+#endif
+	/* rates, over the last complete window */
+	int64_t rate_window_start_ms;
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ALLOC_STATS)
+	uint32_t alloc_window_count;
+	uint32_t alloc_rate;
 #endif
 	/* thread */
 	struct k_sem running;
@@ -79,76 +403,375 @@ struct context {
 
 static struct context g_ctx = {
 	.node = {},
-	.flow = {},
-	.flow_vel = {},
-	.gnss = {},
-	.imu = {},
-	.mag = {},
 #if SYNAPSE_ZENOH_RTCM3_INBOUND
 	.rtcm3 = {},
 #endif
 	.running = Z_SEM_INITIALIZER(g_ctx.running, 1, 1),
+	.wake = K_POLL_SIGNAL_INITIALIZER(g_ctx.wake),
 	.stack_size = MY_STACK_SIZE,
 	.stack_area = g_my_stack_area,
 	.thread_data = {},
 };
 
+/*
+ * A row with an encoder rewrites every batch it gathers, in place, into its
+ * own wire layout just before the put, and goes out under the encoder's value
+ * contract instead of the batch contract.
+ */
+struct row_encoder {
+	const char *contract;
+	/* count samples behind the batch header in slot; returns the new length */
+	size_t (*encode)(uint8_t *slot, size_t count, uint32_t sequence);
+};
+
 /*
  * One row per published topic. A row binds a subscribed zros topic to the
- * fixed-layout struct buffer its samples land in, and to the Zenoh key and
- * value contract those bytes go out under. Adding a topic is a matter of
- * adding a row; the subscriber init, publisher declaration, poll set, run
- * loop and teardown all iterate this table.
+ * fixed-layout struct slots its samples land in, and to the Zenoh key and
+ * value contract those bytes go out under. Its delivery settings rank it
+ * against the other rows when the link saturates: the high-rate inertial and
+ * flow rows drop stale samples at high priority and skip transport batching,
+ * while GNSS fixes are few and block rather than go missing. The shed rank
+ * orders the rows for load shedding: magnetometer first, then flow velocity,
+ * then flow, while inertial samples and fixes are never shed. Adding a topic is
+ * a matter of adding a row to ZENOH_ROWS; the subscriber init, publisher
+ * declaration, poll set, run loop and teardown all iterate this table.
  */
 struct topic_binding {
 	struct zros_topic *topic;
-	void *buffer;
-	size_t size;
+	void *buffer; /* PAYLOAD_SLOTS consecutive slots of stride bytes */
+	size_t size; /* one sample struct */
+	size_t stride;
+	uint16_t batch; /* samples per put, 1 when unbatched */
+	uint16_t batch_latency_ms;
+	uint16_t rate_hz; /* requested subscription rate, or RATE_EVERY_SAMPLE */
+	uint16_t time_status_offset; /* of the time_status byte in a sample */
+	/* delivery: what the publisher does when the link backs up */
+	z_priority_t priority;
+	z_congestion_control_t congestion_control;
+	bool is_express; /* sent at once rather than batched by the transport */
+	uint8_t shed_rank; /* shed from this shed level on, 0 for never */
 	const char *key;
 	const char *contract;
+	const struct row_encoder *encoder; /* NULL puts the structs as they are */
+#if SYNAPSE_ZENOH_LAST_VALUE
+	void *last; /* latest sample taken, served to queries */
+	const char *sample_contract; /* of one sample, even on a batched row */
+#endif
+#if SYNAPSE_ZENOH_ON_CHANGE
+	/* true if sample differs from sent beyond the deadband; NULL puts all */
+	bool (*changed)(const void *sent, const void *sample);
+	void *sent; /* last sample let through */
+	uint16_t heartbeat_ms; /* longest sent is held while nothing changes */
+#endif
 };
 
-static const struct topic_binding topic_table[] = {
-	{
-		.topic = &topic_optical_flow,
-		.buffer = &g_ctx.flow,
-		.size = sizeof(g_ctx.flow),
-		.key = SYNAPSE_TOPIC_OPTICAL_FLOW_KEY,
-		.contract = SYNAPSE_TOPIC_OPTICAL_FLOW_CONTRACT,
-	},
-	{
-		.topic = &topic_optical_flow_vel,
-		.buffer = &g_ctx.flow_vel,
-		.size = sizeof(g_ctx.flow_vel),
-		.key = SYNAPSE_TOPIC_OPTICAL_FLOW_VELOCITY_KEY,
-		.contract = SYNAPSE_TOPIC_OPTICAL_FLOW_VELOCITY_CONTRACT,
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_GNSS_ON_CHANGE)
+/*
+ * A fix changes with its fix type, flags or satellite count, or once it moves
+ * more than the deadband. One 1e-7 degree of latitude is 11.1 mm; the same
+ * band applied to longitude is narrower away from the equator, which errs
+ * towards putting.
+ */
+static bool gnss_changed(const void *sent, const void *sample)
+{
+	const synapse_topic_GnssFix_t *a = sent;
+	const synapse_topic_GnssFix_t *b = sample;
+	const int64_t band_mm = CONFIG_SPINALI_SYNAPSE_ZENOH_GNSS_DEADBAND_MM;
+	const int64_t band_e7 = band_mm * 10 / 111;
+
+	return a->fix_type != b->fix_type || a->flags != b->flags ||
+	       a->satellites_used != b->satellites_used ||
+	       llabs((int64_t)a->latitude_deg_e7 - b->latitude_deg_e7) > band_e7 ||
+	       llabs((int64_t)a->longitude_deg_e7 - b->longitude_deg_e7) > band_e7 ||
+	       llabs((int64_t)a->altitude_msl_mm - b->altitude_msl_mm) > band_mm;
+}
+#endif
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_ON_CHANGE)
+/* A field sample changes with its flags, or once any axis leaves the band. */
+static bool mag_changed(const void *sent, const void *sample)
+{
+	const synapse_topic_MagneticField_t *a = sent;
+	const synapse_topic_MagneticField_t *b = sample;
+	const float band = CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_DEADBAND_NT * 1e-9f;
+
+	return a->flags != b->flags || fabsf(a->mag_flu_tesla.x - b->mag_flu_tesla.x) > band ||
+	       fabsf(a->mag_flu_tesla.y - b->mag_flu_tesla.y) > band ||
+	       fabsf(a->mag_flu_tesla.z - b->mag_flu_tesla.z) > band;
+}
+#endif
+
+#define ROW_BINDING(name, zros_topic, type, row_key, row_contract, hz, row_batch, latency_ms,      \
+		    row_priority, row_congestion_control, express, rank, change_test, heartbeat,   \
+		    row_encoder)                                                                   \
+	{                                                                                          \
+		.topic = &topic_##zros_topic,                                                      \
+		.buffer = g_ctx.name,                                                              \
+		.size = sizeof(type),                                                              \
+		.stride = ROW_SLOT_SIZE(type, row_batch),                                          \
+		.batch = row_batch,                                                                \
+		.batch_latency_ms = latency_ms,                                                    \
+		.rate_hz = hz,                                                                     \
+		.time_status_offset = offsetof(type, time_status),                                 \
+		.priority = row_priority,                                                          \
+		.congestion_control = row_congestion_control,                                      \
+		.is_express = express,                                                             \
+		.shed_rank = rank,                                                                 \
+		.key = row_key,                                                                    \
+		.contract = ROW_CONTRACT(row_contract, row_batch),                                 \
+		.encoder = row_encoder,                                                            \
+		IF_ENABLED(SYNAPSE_ZENOH_LAST_VALUE,                                               \
+			   (.last = g_ctx.name##_last, .sample_contract = row_contract, ))         \
+		IF_ENABLED(SYNAPSE_ZENOH_ON_CHANGE, (.changed = change_test,                       \
+						     .sent = g_ctx.name##_sent,                    \
+						     .heartbeat_ms = heartbeat, ))                 \
 	},
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_IMU_COMPACT)
+static const struct row_encoder imu_compact_encoder = {
+	.contract = SYNAPSE_ZENOH_COMPACT_IMU_CONTRACT,
+	.encode = synapse_zenoh_compact_imu,
+};
+#endif
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_COMPACT)
+static const struct row_encoder mag_compact_encoder = {
+	.contract = SYNAPSE_ZENOH_COMPACT_MAG_CONTRACT,
+	.encode = synapse_zenoh_compact_mag,
+};
+#endif
+
+static const struct topic_binding topic_table[] = {ZENOH_ROWS(ROW_BINDING)};
+
+BUILD_ASSERT(ARRAY_SIZE(topic_table) > 0, "enable at least one SPINALI_SYNAPSE_ZENOH_ROW_*");
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_LINK_UDP)
+/*
+ * Over UDP a put split across datagrams is lost whole when any one of them
+ * is, so every row's largest put has to fit one datagram: its payload slot,
+ * the attachment, and the zenoh framing around them. The framing is counted
+ * from the zenoh wire format, with every variable-length integer at the
+ * widest the value it carries can take:
+ *
+ *   frame    header, sequence number (28 bits, 4 bytes)
+ *   push     header, key expression id (2), key length (2) and key, the
+ *            namespaced one as topic_keyexpr builds it, QoS extension (2)
+ *   put      header, encoding id (2), contract length (2) and contract, which
+ *            goes out on every put, attachment extension header and length (3),
+ *            payload length (3)
+ */
+#define ZENOH_FRAME_OVERHEAD (1U + 4U)
+#define ZENOH_PUSH_OVERHEAD(key)                                                                   \
+	(1U + 2U + 2U + sizeof(CONFIG_SPINALI_SYNAPSE_ZENOH_NAMESPACE "/" key) - 1U + 2U)
+#define ZENOH_PUT_OVERHEAD(contract_len) (1U + 2U + 2U + (contract_len) + 3U + 3U)
+
+/* Length of a row's contract; ROW_CONTRACT would decay to a pointer here. */
+#define ROW_CONTRACT_LEN(contract, batch)                                                          \
+	((batch) > 1 ? sizeof(contract SYNAPSE_ZENOH_BATCH_SUFFIX) - 1U : sizeof(contract) - 1U)
+
+#define ROW_UDP_PUT_FITS(name, zros_topic, type, key, contract, hz, batch, ...)                   \
+	BUILD_ASSERT(ZENOH_FRAME_OVERHEAD + ZENOH_PUSH_OVERHEAD(key) +                             \
+			     ZENOH_PUT_OVERHEAD(ROW_CONTRACT_LEN(contract, batch)) +               \
+			     sizeof(struct synapse_zenoh_PutAttachment) +                          \
+			     ROW_SLOT_SIZE(type, batch) <=                                         \
+		     CONFIG_SPINALI_SYNAPSE_ZENOH_UDP_DATAGRAM,                                    \
+		     "row " #name " put does not fit one UDP datagram, lower its batch");
+
+ZENOH_ROWS(ROW_UDP_PUT_FITS)
+
+/* A compact row puts less than its slot under a shorter contract. */
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_IMU_COMPACT)
+BUILD_ASSERT(sizeof(SYNAPSE_ZENOH_COMPACT_IMU_CONTRACT) - 1U <=
+	     ROW_CONTRACT_LEN(SYNAPSE_TOPIC_IMU_CONTRACT, IMU_BATCH));
+#endif
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_MAG_COMPACT)
+BUILD_ASSERT(sizeof(SYNAPSE_ZENOH_COMPACT_MAG_CONTRACT) - 1U <=
+	     ROW_CONTRACT_LEN(SYNAPSE_TOPIC_MAG_CONTRACT, MAG_BATCH));
+#endif
+#endif
+
+#if SYNAPSE_ZENOH_INBOUND
+/*
+ * One row per subscribed Zenoh key, the inbound counterpart of topic_table. A
+ * row binds a key and value contract to the zros topic its samples are
+ * republished on, and to the message buffer they are decoded into. The
+ * network-sourced *_ethernet topics are the ones the controllers already
+ * arbitrate against their local sources.
+ */
+struct inbound_binding {
+	struct zros_topic *topic;
+	void *buffer; /* one decoded message, the zros publication source */
+	const pb_msgdesc_t *fields;
+	size_t max_size; /* longest valid encoding */
+	const char *key;
+	const char *contract;
+};
+
+static const struct inbound_binding inbound_table[] = {
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_CMD_VEL_SUB)
 	{
-		.topic = &topic_nav_sat_fix,
-		.buffer = &g_ctx.gnss,
-		.size = sizeof(g_ctx.gnss),
-		.key = SYNAPSE_TOPIC_GNSS_KEY,
-		.contract = SYNAPSE_TOPIC_GNSS_CONTRACT,
+		.topic = &topic_cmd_vel_ethernet,
+		.buffer = &g_ctx.cmd_vel,
+		.fields = synapse_pb_Twist_fields,
+		.max_size = synapse_pb_Twist_size,
+		.key = "cmd_vel",
+		.contract = SYNAPSE_PB_CONTRACT("Twist"),
 	},
+#endif
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_BEZIER_TRAJECTORY_SUB)
 	{
-		.topic = &topic_imu,
-		.buffer = &g_ctx.imu,
-		.size = sizeof(g_ctx.imu),
-		.key = SYNAPSE_TOPIC_IMU_KEY,
-		.contract = SYNAPSE_TOPIC_IMU_CONTRACT,
+		.topic = &topic_bezier_trajectory_ethernet,
+		.buffer = &g_ctx.bezier_trajectory,
+		.fields = synapse_pb_BezierTrajectory_fields,
+		.max_size = synapse_pb_BezierTrajectory_size,
+		.key = "bezier_trajectory",
+		.contract = SYNAPSE_PB_CONTRACT("BezierTrajectory"),
 	},
+#endif
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ODOMETRY_SUB)
 	{
-		.topic = &topic_mag,
-		.buffer = &g_ctx.mag,
-		.size = sizeof(g_ctx.mag),
-		.key = SYNAPSE_TOPIC_MAG_KEY,
-		.contract = SYNAPSE_TOPIC_MAG_CONTRACT,
+		.topic = &topic_odometry_ethernet,
+		.buffer = &g_ctx.odometry,
+		.fields = synapse_pb_Odometry_fields,
+		.max_size = synapse_pb_Odometry_size,
+		.key = "odometry",
+		.contract = SYNAPSE_PB_CONTRACT("Odometry"),
 	},
+#endif
+};
+
+/*
+ * Receive state of an inbound row. The contract is parsed once at declaration
+ * so that the per-sample check is a comparison rather than a string build.
+ */
+struct inbound_row {
+	struct context *ctx;
+	z_owned_subscriber_t reader;
+	z_owned_encoding_t contract;
+	struct zros_pub pub;
+	struct inbound_latency latency;
+	uint32_t bad_contract;
+	uint32_t bad_size;
+	uint32_t bad_decode;
+};
+
+static struct inbound_row inbound[ARRAY_SIZE(inbound_table)];
+#endif /* SYNAPSE_ZENOH_INBOUND */
+
+/*
+ * Payload slots of one row. A set bit in lent marks a slot a zenoh payload
+ * still references; the release callback clears it from whichever thread
+ * drops that payload. cur is the slot the row's subscription writes into, and
+ * is never lent while it does; fill counts the samples already in it, which
+ * stays below one except on a batched row, whose partial batch is put at
+ * flush_at_ms at the latest. sequence counts the row's puts; each slot keeps
+ * the attachment of its put for as long as it keeps the payload.
+ */
+struct payload_ring {
+	atomic_t lent;
+	uint8_t cur;
+	uint16_t fill;
+	int64_t flush_at_ms;
+	uint32_t sequence;
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ATTACHMENT)
+	struct synapse_zenoh_PutAttachment attachment[PAYLOAD_SLOTS];
+#endif
+};
+
+BUILD_ASSERT(PAYLOAD_SLOTS <= 32, "lent is a 32 bit slot mask");
+
+/*
+ * Per-row statistics. samples counts what the row took from zros, puts and
+ * put_errors what it handed to zenoh, bytes the payload bytes of the
+ * successful puts. put_us times the z_publisher_put call itself, and age_us
+ * the age of every sample at the moment of its put: the current time in the
+ * clock domain its time_status names, minus its timestamp_ns.
+ */
+struct row_stats {
+	uint32_t samples;
+	uint32_t puts;
+	uint32_t put_errors;
+	uint64_t bytes;
+	struct hist put_us;
+	struct hist age_us;
+	/* effective sample rate, over the last complete window */
+	uint32_t window_samples;
+	uint32_t hz;
+	/* answered from the last-value cache, by the read task in a multi-thread build */
+	atomic_t queries;
+	uint32_t unchanged; /* held back by publish-on-change */
+	uint32_t unmatched; /* taken while no subscriber matched */
+	uint32_t disabled; /* taken while the row was switched off */
+	uint32_t shed; /* dropped by load shedding */
+	uint32_t no_slot; /* dropped while zenoh held every payload slot */
 };
 
+/*
+ * Each row also exports its counters as an mcumgr stat group named after its
+ * key, refreshed once per rate window. bytes wraps at 32 bits there.
+ */
+#if defined(CONFIG_STATS)
+STATS_SECT_START(zenoh_row)
+STATS_SECT_ENTRY32(samples)
+STATS_SECT_ENTRY32(puts)
+STATS_SECT_ENTRY32(put_errors)
+STATS_SECT_ENTRY32(bytes)
+STATS_SECT_ENTRY32(put_us_max)
+STATS_SECT_ENTRY32(age_us_max)
+STATS_SECT_END;
+
+STATS_NAME_START(zenoh_row)
+STATS_NAME(zenoh_row, samples)
+STATS_NAME(zenoh_row, puts)
+STATS_NAME(zenoh_row, put_errors)
+STATS_NAME(zenoh_row, bytes)
+STATS_NAME(zenoh_row, put_us_max)
+STATS_NAME(zenoh_row, age_us_max)
+STATS_NAME_END(zenoh_row);
+#endif /* CONFIG_STATS */
+
 /* Parallel per-row state, indexed the same way as topic_table. */
 static struct zros_sub subs[ARRAY_SIZE(topic_table)];
 static z_owned_publisher_t publishers[ARRAY_SIZE(topic_table)];
+#if SYNAPSE_ZENOH_MATCHING
+static z_owned_matching_listener_t matching_listeners[ARRAY_SIZE(topic_table)];
+/* one bit per row with a matching subscriber, kept by the listeners */
+static atomic_t matched;
+#endif
+static struct payload_ring rings[ARRAY_SIZE(topic_table)];
+static struct row_stats stats[ARRAY_SIZE(topic_table)];
+/* where a sample that finds no free payload slot is taken, to be dropped */
+static union row_sample_any no_slot_sample;
+/* rows switched off from the shell; written there, read by the run loop */
+static atomic_t disabled_rows;
+#if SYNAPSE_ZENOH_LIVELINESS
+static z_owned_liveliness_token_t node_token;
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_LIVELINESS_ROWS)
+static z_owned_liveliness_token_t row_tokens[ARRAY_SIZE(topic_table)];
+static uint32_t row_tokens_declared; /* one bit per row holding a token */
+#endif
+#endif
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+/* samples each row has dropped since it last put one while shed */
+static uint8_t shed_skipped[ARRAY_SIZE(topic_table)];
+#endif
+#if SYNAPSE_ZENOH_ON_CHANGE
+/* when each row last let a sample through, or -1 to let the next one through */
+static int64_t sent_at_ms[ARRAY_SIZE(topic_table)];
+#endif
+#if defined(CONFIG_STATS)
+static STATS_SECT_DECL(zenoh_row) stat_groups[ARRAY_SIZE(topic_table)];
+static char stat_group_names[ARRAY_SIZE(topic_table)][KEYEXPR_MAX];
+#endif
+
+/*
+ * Persistent poll set: one event per row, indexed like topic_table, then the
+ * wake signal. Only the rows whose event fired are dispatched.
+ */
+#define WAKE_EVENT ARRAY_SIZE(topic_table)
+static struct k_poll_event events[ARRAY_SIZE(topic_table) + 1];
+
+BUILD_ASSERT(ARRAY_SIZE(topic_table) <= 32, "the ready mask holds one bit per row");
 
 static int zenoh_session_init(struct context *ctx)
 {
@@ -163,17 +786,15 @@ static int zenoh_session_init(struct context *ctx)
 
 	LOG_INF("Opening zenoh session (%s) via %s ...", mode, locator);
 
+	z_config_default(&config);
+	zp_config_insert(z_loan_mut(config), Z_CONFIG_MODE_KEY, mode);
+	zp_config_insert(z_loan_mut(config), Z_CONFIG_CONNECT_KEY, locator);
 
-	do {
-		z_config_default(&config);
-		zp_config_insert(z_loan_mut(config), Z_CONFIG_MODE_KEY, mode);
-		zp_config_insert(z_loan_mut(config), Z_CONFIG_CONNECT_KEY, locator);
-
-		if (ret != 0) {
-			LOG_WRN("Unable to open session (ret=%d), retrying...", ret);
-			k_sleep(K_SECONDS(5));
-		}
-	} while ((ret = z_open(&ctx->session, z_move(config), NULL)) < 0);
+	ret = z_open(&ctx->session, z_move(config), NULL);
+	if (ret < 0) {
+		LOG_WRN("Unable to open session (ret=%d)", ret);
+		return ret;
+	}
 
 #if Z_FEATURE_MULTI_THREAD == 1
 	if (zp_start_read_task(z_loan_mut(ctx->session), NULL) < 0 ||
@@ -206,9 +827,12 @@ static int topic_keyexpr(const char *key, char *out, size_t out_size)
 	return (len > 0 && (size_t)len < out_size) ? 0 : -EINVAL;
 }
 
-static int declare_topic_publisher(struct context *ctx, z_owned_publisher_t *pub, const char *key,
-				   const char *contract)
+static int declare_topic_publisher(struct context *ctx, z_owned_publisher_t *pub,
+				   const struct topic_binding *binding)
 {
+	const char *key = binding->key;
+	const char *contract = binding->encoder != NULL ? binding->encoder->contract
+							: binding->contract;
 	char keyexpr[KEYEXPR_MAX];
 	z_publisher_options_t options;
 	z_owned_encoding_t encoding;
@@ -235,6 +859,9 @@ static int declare_topic_publisher(struct context *ctx, z_owned_publisher_t *pub
 
 	z_publisher_options_default(&options);
 	options.encoding = z_move(encoding);
+	options.priority = binding->priority;
+	options.congestion_control = binding->congestion_control;
+	options.is_express = binding->is_express;
 
 	ret = z_declare_publisher(z_loan(ctx->session), pub, z_loan(ke), &options);
 	if (ret < 0) {
@@ -242,15 +869,79 @@ static int declare_topic_publisher(struct context *ctx, z_owned_publisher_t *pub
 		return ret;
 	}
 
-	LOG_INF("Zenoh publisher %s", keyexpr);
+	LOG_INF("Zenoh publisher %s (priority %d, %s%s)", keyexpr, (int)binding->priority,
+		binding->congestion_control == Z_CONGESTION_CONTROL_DROP ? "drop" : "block",
+		binding->is_express ? ", express" : "");
 	return 0;
 }
 
+#if SYNAPSE_ZENOH_MATCHING
+/*
+ * Runs in the zenoh read task of a multi-thread build, from zp_spin_once
+ * otherwise; the run loop picks the new status up with the row's next sample.
+ */
+static void matching_status_handler(const z_matching_status_t *status, void *arg)
+{
+	int row = (int)((const struct topic_binding *)arg - topic_table);
+
+	if (status->matching) {
+		atomic_set_bit(&matched, row);
+	} else {
+		atomic_clear_bit(&matched, row);
+	}
+}
+
+/*
+ * Seed the row's bit from the publisher's current status, then let the
+ * listener report every change. A row whose status cannot be read counts as
+ * matched, so a failed query costs puts rather than samples.
+ */
+static int declare_matching_listener(size_t row)
+{
+	z_owned_closure_matching_status_t closure;
+	z_matching_status_t status;
+	int ret;
+
+	if (z_publisher_get_matching_status(z_loan(publishers[row]), &status) == 0 &&
+	    !status.matching) {
+		atomic_clear_bit(&matched, (int)row);
+	} else {
+		atomic_set_bit(&matched, (int)row);
+	}
+
+	z_closure_matching_status(&closure, matching_status_handler, NULL,
+				  (void *)&topic_table[row]);
+	ret = z_publisher_declare_matching_listener(z_loan(publishers[row]),
+						    &matching_listeners[row], z_move(closure));
+	if (ret < 0) {
+		LOG_ERR("Unable to declare matching listener for %s", topic_table[row].key);
+	}
+
+	return ret;
+}
+#endif /* SYNAPSE_ZENOH_MATCHING */
+
+/* Whether a subscriber wants the row's samples; always, without matching. */
+static inline bool row_matched(size_t row)
+{
+#if SYNAPSE_ZENOH_MATCHING
+	return atomic_test_bit(&matched, (int)row);
+#else
+	ARG_UNUSED(row);
+	return true;
+#endif
+}
+
 static int zenoh_publishers_init(struct context *ctx)
 {
 	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
-		int ret = declare_topic_publisher(ctx, &publishers[i], topic_table[i].key,
-						  topic_table[i].contract);
+		int ret = declare_topic_publisher(ctx, &publishers[i], &topic_table[i]);
+
+#if SYNAPSE_ZENOH_MATCHING
+		if (ret == 0) {
+			ret = declare_matching_listener(i);
+		}
+#endif
 		if (ret < 0) {
 			return ret;
 		}
@@ -259,87 +950,1025 @@ static int zenoh_publishers_init(struct context *ctx)
 	return 0;
 }
 
-static void publish_struct(const z_loaned_publisher_t *pub, const void *data, size_t size)
+static inline uint8_t *row_slot(size_t row, size_t slot)
 {
-	z_owned_bytes_t payload;
+	return (uint8_t *)topic_table[row].buffer + slot * topic_table[row].stride;
+}
 
-	if (z_bytes_copy_from_buf(&payload, data, size) < 0) {
-		return;
-	}
+/* Sample n of a slot, which on a batched row starts past the batch header. */
+static inline uint8_t *slot_sample(size_t row, size_t slot, size_t n)
+{
+	size_t offset = topic_table[row].batch > 1 ? sizeof(struct synapse_zenoh_BatchHeader) : 0;
 
-	/* Encoding comes from the publisher declaration. */
-	z_publisher_put(pub, z_move(payload), NULL);
+	return row_slot(row, slot) + offset + n * topic_table[row].size;
 }
 
-#if SYNAPSE_ZENOH_RTCM3_INBOUND
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ZERO_COPY)
 /*
- * Copy the received RTCM3 bytes into the topic buffer and republish them on
- * topic_rtcm3, where the RTCM3 forwarder picks them up and hands them to the
- * GNSS receiver. The payload is opaque, so a frame longer than the buffer or a
- * short read is dropped rather than truncated. Runs in the zenoh read task
- * (multi-thread) or inside zp_spin_once (single-thread); zros_topic_publish is
- * thread-safe under both.
+ * Release callback of a lent slot. zenoh-pico drops the payload once it has
+ * serialized it into its transmit batch, which in practice is before
+ * z_publisher_put returns, but a transport that holds on to it releases it
+ * from its own thread later; the atomic mask covers both.
  */
-static void rtcm3_recv_handler(z_loaned_sample_t *sample, void *arg)
+static void payload_release(void *data, void *context)
 {
-	struct context *ctx = arg;
-	const z_loaned_bytes_t *payload = z_sample_payload(sample);
-	size_t len = z_bytes_len(payload);
-	z_bytes_reader_t reader;
-
-	if (len == 0 || len > sizeof(ctx->rtcm3.data.bytes)) {
-		LOG_WRN("dropping rtcm3 frame of %zu bytes", len);
-		return;
-	}
-
-	reader = z_bytes_get_reader(payload);
-	if (z_bytes_reader_read(&reader, ctx->rtcm3.data.bytes, len) != len) {
-		LOG_WRN("short read on rtcm3 frame");
-		return;
-	}
+	struct payload_ring *ring = context;
+	size_t row = (size_t)(ring - rings);
+	size_t slot = (size_t)((uint8_t *)data - row_slot(row, 0)) / topic_table[row].stride;
 
-	ctx->rtcm3.data.size = len;
-	zros_pub_update(&ctx->pub_rtcm3);
+	atomic_clear_bit(&ring->lent, (int)slot);
 }
+#endif /* CONFIG_SPINALI_SYNAPSE_ZENOH_ZERO_COPY */
 
-static int zenoh_rtcm3_sub_init(struct context *ctx)
+/*
+ * Point the row's subscription at the place its next sample belongs: the next
+ * free position of the batch being filled, or else the first sample of the
+ * first free slot from cur on, so the sample lands where nothing references
+ * it. zros has no setter for the buffer of an initialized subscription, so
+ * this retargets its message pointer directly. Returns false while zenoh holds
+ * every slot; the caller then takes the sample elsewhere and drops it.
+ */
+static bool payload_ring_claim(size_t row)
 {
-	char keyexpr[KEYEXPR_MAX];
-	z_owned_closure_sample_t closure;
-	z_view_keyexpr_t ke;
-	int ret;
+	struct payload_ring *ring = &rings[row];
 
-	ret = zros_pub_init(&ctx->pub_rtcm3, &ctx->node, &topic_rtcm3, &ctx->rtcm3);
-	if (ret < 0) {
-		LOG_ERR("init pub rtcm3 failed: %d", ret);
-		return ret;
-	}
+	if (ring->fill == 0) {
+		size_t n;
 
-	ret = topic_keyexpr(SYNAPSE_TOPIC_RTCM3_KEY, keyexpr, sizeof(keyexpr));
-	if (ret < 0) {
-		LOG_ERR("Key expression too long for %s", SYNAPSE_TOPIC_RTCM3_KEY);
-		return ret;
+		for (n = 0; n < PAYLOAD_SLOTS; n++) {
+			size_t slot = (ring->cur + n) % PAYLOAD_SLOTS;
+
+			if (!atomic_test_bit(&ring->lent, (int)slot)) {
+				ring->cur = (uint8_t)slot;
+				break;
+			}
+		}
+		if (n == PAYLOAD_SLOTS) {
+			return false;
+		}
 	}
 
-	ret = z_view_keyexpr_from_str(&ke, keyexpr);
-	if (ret < 0) {
-		LOG_ERR("Invalid key expression %s", keyexpr);
-		return ret;
+	subs[row]._msg = slot_sample(row, ring->cur, ring->fill);
+	return true;
+}
+
+#if defined(CONFIG_PTP_CLOCK)
+static uint64_t phc_now_ns(const struct device *phc)
+{
+	struct net_ptp_time now;
+
+	if (phc == NULL || ptp_clock_get(phc, &now) != 0) {
+		return 0;
 	}
 
-	z_closure_sample(&closure, rtcm3_recv_handler, NULL, ctx);
+	return (uint64_t)now.second * NSEC_PER_SEC + now.nanosecond;
+}
+#endif
 
-	ret = z_declare_subscriber(z_loan(ctx->session), &ctx->rtcm3_reader, z_loan(ke),
+/*
+ * Record the age of the samples about to be put. A payload stamped on the
+ * node-local boot clock is aged against the boot clock, one stamped on the
+ * gPTP timescale against the PHC; a sample whose clock cannot be read, or
+ * that claims to come from the future, is left out.
+ */
+static void record_sample_age(struct context *ctx, size_t row, size_t slot, size_t count)
+{
+	uint64_t boot_ns = k_ticks_to_ns_floor64(k_uptime_ticks());
+	uint64_t phc_ns = 0;
+	bool phc_read = false;
+
+	for (size_t n = 0; n < count; n++) {
+		const uint8_t *sample = slot_sample(row, slot, n);
+		uint8_t time_status = sample[topic_table[row].time_status_offset];
+		uint64_t timestamp_ns;
+		uint64_t now_ns = boot_ns;
+
+		/* every synapse struct leads with its uint64 timestamp_ns */
+		memcpy(&timestamp_ns, sample, sizeof(timestamp_ns));
+
+		if (time_status != SYNAPSE_TYPES_TIME_STATUS_LOCAL_FREERUN) {
+#if defined(CONFIG_PTP_CLOCK)
+			if (!phc_read) {
+				phc_ns = phc_now_ns(ctx->phc);
+				phc_read = true;
+			}
+#else
+			ARG_UNUSED(ctx);
+			ARG_UNUSED(phc_read);
+#endif
+			now_ns = phc_ns;
+		}
+
+		if (now_ns != 0 && now_ns >= timestamp_ns) {
+			hist_record(&stats[row].age_us,
+				    (uint32_t)MIN((now_ns - timestamp_ns) / NSEC_PER_USEC, UINT32_MAX));
+		}
+	}
+}
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ATTACHMENT)
+/*
+ * Now, on the clock a row's samples are stamped on: the PHC for samples on
+ * the gPTP timescale, the boot clock for the others and whenever the PHC
+ * cannot be read. time_status is updated to the clock actually read.
+ */
+static uint64_t row_clock_now_ns(struct context *ctx, uint8_t *time_status)
+{
+#if defined(CONFIG_PTP_CLOCK)
+	if (*time_status != SYNAPSE_TYPES_TIME_STATUS_LOCAL_FREERUN) {
+		uint64_t phc_ns = phc_now_ns(ctx->phc);
+
+		if (phc_ns != 0) {
+			return phc_ns;
+		}
+	}
+#else
+	ARG_UNUSED(ctx);
+#endif
+
+	*time_status = SYNAPSE_TYPES_TIME_STATUS_LOCAL_FREERUN;
+	return k_ticks_to_ns_floor64(k_uptime_ticks());
+}
+
+/*
+ * Stamp the slot's attachment and hand it to the put options. Like the
+ * payload, it is sent by reference from the slot with zero-copy publishing
+ * and copied otherwise. A put whose attachment cannot be built goes out
+ * without one.
+ */
+static void put_attachment(struct context *ctx, struct synapse_zenoh_PutAttachment *att,
+			   z_owned_bytes_t *bytes, z_publisher_put_options_t *options)
+{
+	int ret;
+
+	att->put_ns = row_clock_now_ns(ctx, &att->time_status);
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ZERO_COPY)
+	ret = z_bytes_from_static_buf(bytes, (const uint8_t *)att, sizeof(*att));
+#else
+	ret = z_bytes_copy_from_buf(bytes, (const uint8_t *)att, sizeof(*att));
+#endif
+	if (ret == 0) {
+		options->attachment = z_move(*bytes);
+	}
+}
+#endif /* CONFIG_SPINALI_SYNAPSE_ZENOH_ATTACHMENT */
+
+/*
+ * Put the samples gathered in the current slot. With zero-copy publishing the
+ * slot is lent to zenoh and sent by reference; otherwise it is copied into a
+ * freshly allocated zenoh-pico buffer. A batched row prefixes the header, or
+ * has its encoder rewrite the slot.
+ */
+static void publish_row(struct context *ctx, size_t row)
+{
+	const struct topic_binding *binding = &topic_table[row];
+	struct payload_ring *ring = &rings[row];
+	struct row_stats *st = &stats[row];
+	uint8_t *slot = row_slot(row, ring->cur);
+	size_t len = (size_t)ring->fill * binding->size;
+	uint32_t sequence = ring->sequence++;
+	z_publisher_put_options_t options;
+	z_owned_bytes_t payload;
+	uint32_t start_cyc;
+	uint32_t put_us;
+	int ret;
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ATTACHMENT)
+	struct synapse_zenoh_PutAttachment *att = &ring->attachment[ring->cur];
+	z_owned_bytes_t attachment;
+
+	*att = (struct synapse_zenoh_PutAttachment){
+		.sequence = sequence,
+		.time_status = slot_sample(row, ring->cur, 0)[binding->time_status_offset],
+	};
+#endif
+
+	/* before an encoder overwrites the structs it reads */
+	record_sample_age(ctx, row, ring->cur, ring->fill);
+
+	if (binding->encoder != NULL) {
+		len = binding->encoder->encode(slot, ring->fill, sequence);
+	} else if (binding->batch > 1) {
+		struct synapse_zenoh_BatchHeader hdr = {
+			.sequence = sequence,
+			.count = ring->fill,
+			.sample_size = (uint16_t)binding->size,
+		};
+
+		memcpy(slot, &hdr, sizeof(hdr));
+		len += sizeof(hdr);
+	}
+	ring->fill = 0;
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ZERO_COPY)
+	atomic_set_bit(&ring->lent, ring->cur);
+	ret = z_bytes_from_buf(&payload, slot, len, payload_release, ring);
+	if (ret < 0) {
+		atomic_clear_bit(&ring->lent, ring->cur);
+	}
+#else
+	ret = z_bytes_copy_from_buf(&payload, slot, len);
+#endif
+	ring->cur = (uint8_t)((ring->cur + 1U) % PAYLOAD_SLOTS);
+	if (ret < 0) {
+		st->put_errors++;
+		return;
+	}
+
+	/* Encoding comes from the publisher declaration. */
+	z_publisher_put_options_default(&options);
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ATTACHMENT)
+	put_attachment(ctx, att, &attachment, &options);
+#endif
+	start_cyc = k_cycle_get_32();
+	ret = z_publisher_put(z_loan(publishers[row]), z_move(payload), &options);
+	put_us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cyc);
+	hist_record(&st->put_us, put_us);
+	st->puts++;
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+	ctx->shed_puts++;
+	ctx->shed_put_us += put_us;
+	ctx->shed_put_errors += ret < 0 ? 1U : 0U;
+#endif
+	if (ret < 0) {
+		st->put_errors++;
+		ctx->link_errors++;
+		return;
+	}
+
+	st->bytes += len;
+	ctx->link_errors = 0;
+	if (ctx->first_put_pending) {
+		ctx->first_put_pending = false;
+		ctx->last_first_put_ms = (uint32_t)(k_uptime_get() - ctx->opened_at_ms);
+	}
+}
+
+#if SYNAPSE_ZENOH_LAST_VALUE
+/*
+ * The cache is written from the run loop and read from the query handler,
+ * which in a multi-thread build runs in the zenoh read task; the copies under
+ * the lock are one sample struct each.
+ */
+static struct k_spinlock last_value_lock;
+static bool last_value_valid[ARRAY_SIZE(topic_table)];
+static z_owned_queryable_t queryables[ARRAY_SIZE(topic_table)];
+
+static void last_value_store(size_t row, const uint8_t *sample)
+{
+	k_spinlock_key_t key = k_spin_lock(&last_value_lock);
+
+	memcpy(topic_table[row].last, sample, topic_table[row].size);
+	last_value_valid[row] = true;
+	k_spin_unlock(&last_value_lock, key);
+}
+
+/*
+ * Reply with the row's latest sample, as a single sample under the row's
+ * key and sample contract; its timestamp_ns says how old it is. A row that
+ * has not seen a sample yet leaves the query unanswered.
+ */
+static void last_value_query_handler(z_loaned_query_t *query, void *arg)
+{
+	const struct topic_binding *binding = arg;
+	size_t row = (size_t)(binding - topic_table);
+	union row_sample_any sample;
+	char keyexpr[KEYEXPR_MAX];
+	z_query_reply_options_t options;
+	z_owned_encoding_t encoding;
+	z_owned_bytes_t payload;
+	z_view_keyexpr_t ke;
+	k_spinlock_key_t key;
+	bool valid;
+
+	key = k_spin_lock(&last_value_lock);
+	valid = last_value_valid[row];
+	if (valid) {
+		memcpy(&sample, binding->last, binding->size);
+	}
+	k_spin_unlock(&last_value_lock, key);
+
+	if (!valid || topic_keyexpr(binding->key, keyexpr, sizeof(keyexpr)) < 0 ||
+	    z_view_keyexpr_from_str(&ke, keyexpr) < 0 ||
+	    z_encoding_from_str(&encoding, binding->sample_contract) < 0) {
+		return;
+	}
+
+	if (z_bytes_copy_from_buf(&payload, (const uint8_t *)&sample, binding->size) < 0) {
+		z_drop(z_move(encoding));
+		return;
+	}
+
+	z_query_reply_options_default(&options);
+	options.encoding = z_move(encoding);
+	if (z_query_reply(query, z_loan(ke), z_move(payload), &options) == 0) {
+		atomic_inc(&stats[row].queries);
+	}
+}
+
+static int last_value_declare(struct context *ctx)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		char keyexpr[KEYEXPR_MAX];
+		z_owned_closure_query_t closure;
+		z_view_keyexpr_t ke;
+		int ret;
+
+		ret = topic_keyexpr(topic_table[i].key, keyexpr, sizeof(keyexpr));
+		if (ret < 0) {
+			LOG_ERR("Key expression too long for %s", topic_table[i].key);
+			return ret;
+		}
+
+		ret = z_view_keyexpr_from_str(&ke, keyexpr);
+		if (ret < 0) {
+			LOG_ERR("Invalid key expression %s", keyexpr);
+			return ret;
+		}
+
+		z_closure_query(&closure, last_value_query_handler, NULL,
+				(void *)&topic_table[i]);
+		ret = z_declare_queryable(z_loan(ctx->session), &queryables[i], z_loan(ke),
+					  z_move(closure), NULL);
+		if (ret < 0) {
+			LOG_ERR("Unable to declare queryable %s", keyexpr);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void last_value_undeclare(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		z_undeclare_queryable(z_move(queryables[i]));
+	}
+}
+#endif /* SYNAPSE_ZENOH_LAST_VALUE */
+
+#if SYNAPSE_ZENOH_ON_CHANGE
+/*
+ * Decide whether a sample goes out under the row's publish-on-change policy.
+ * A sample that is let through becomes the reference the next ones are
+ * compared against; one that is held back stays where it landed and is
+ * overwritten by the next.
+ */
+static bool row_sample_changed(size_t row, const uint8_t *sample)
+{
+	const struct topic_binding *binding = &topic_table[row];
+	int64_t now;
+
+	if (binding->changed == NULL) {
+		return true;
+	}
+
+	now = k_uptime_get();
+	if (sent_at_ms[row] >= 0 && now - sent_at_ms[row] < binding->heartbeat_ms &&
+	    !binding->changed(binding->sent, sample)) {
+		return false;
+	}
+
+	memcpy(binding->sent, sample, binding->size);
+	sent_at_ms[row] = now;
+	return true;
+}
+#endif /* SYNAPSE_ZENOH_ON_CHANGE */
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+/* Whether the current shed level drops this sample of the row. */
+static bool row_shed(struct context *ctx, size_t row)
+{
+	uint8_t rank = topic_table[row].shed_rank;
+	uint8_t keep_shift;
+
+	if (rank == 0 || ctx->shed_level < rank) {
+		shed_skipped[row] = 0;
+		return false;
+	}
+
+	keep_shift = (uint8_t)(ctx->shed_level - rank + 1U);
+	if (++shed_skipped[row] < BIT(keep_shift)) {
+		return true;
+	}
+
+	shed_skipped[row] = 0;
+	return false;
+}
+
+/* Close the shed period once it has run its length and adjust the level. */
+static void shed_update(struct context *ctx)
+{
+	int64_t now = k_uptime_get();
+	bool congested;
+
+	if (now - ctx->shed_period_start_ms < CONFIG_SPINALI_SYNAPSE_ZENOH_SHED_PERIOD_MS) {
+		return;
+	}
+
+	congested = ctx->shed_put_errors > 0 || ctx->shed_backlog > 0 ||
+		    (ctx->shed_puts > 0 &&
+		     ctx->shed_put_us / ctx->shed_puts > CONFIG_SPINALI_SYNAPSE_ZENOH_SHED_PUT_US);
+
+	if (congested) {
+		ctx->shed_clear_periods = 0;
+		if (ctx->shed_level < SHED_LEVEL_MAX) {
+			ctx->shed_level++;
+			LOG_WRN("Zenoh link congested, shed level %u", ctx->shed_level);
+		}
+	} else if (ctx->shed_level > 0 &&
+		   ++ctx->shed_clear_periods >= CONFIG_SPINALI_SYNAPSE_ZENOH_SHED_RECOVER_PERIODS) {
+		ctx->shed_clear_periods = 0;
+		ctx->shed_level--;
+		LOG_INF("Zenoh link clearing, shed level %u", ctx->shed_level);
+	}
+
+	ctx->shed_period_start_ms = now;
+	ctx->shed_puts = 0;
+	ctx->shed_put_errors = 0;
+	ctx->shed_backlog = 0;
+	ctx->shed_put_us = 0;
+}
+#endif /* CONFIG_SPINALI_SYNAPSE_ZENOH_SHED */
+
+/*
+ * Account a sample that just landed; put the slot once it is full. The
+ * last-value cache sees every sample, also one that goes unput because its
+ * row is off, no subscriber matches, the link sheds it or publish-on-change
+ * holds it back.
+ */
+static void row_sample(struct context *ctx, size_t row)
+{
+	struct payload_ring *ring = &rings[row];
+
+	stats[row].samples++;
+#if SYNAPSE_ZENOH_LAST_VALUE
+	last_value_store(row, slot_sample(row, ring->cur, ring->fill));
+#endif
+	if (atomic_test_bit(&disabled_rows, (int)row) || !row_matched(row)) {
+		if (atomic_test_bit(&disabled_rows, (int)row)) {
+			stats[row].disabled++;
+		} else {
+			stats[row].unmatched++;
+		}
+#if SYNAPSE_ZENOH_ON_CHANGE
+		/* once the row is on and matched again, its next sample goes out */
+		sent_at_ms[row] = -1;
+#endif
+		return;
+	}
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+	if (row_shed(ctx, row)) {
+		stats[row].shed++;
+		return;
+	}
+#endif
+#if SYNAPSE_ZENOH_ON_CHANGE
+	if (!row_sample_changed(row, slot_sample(row, ring->cur, ring->fill))) {
+		stats[row].unchanged++;
+		return;
+	}
+#endif
+	if (ring->fill++ == 0) {
+		ring->flush_at_ms = k_uptime_get() + topic_table[row].batch_latency_ms;
+	}
+	if (ring->fill >= topic_table[row].batch) {
+		publish_row(ctx, row);
+	}
+}
+
+/* Put every partial batch whose oldest sample has waited long enough. */
+static void flush_due_batches(struct context *ctx)
+{
+	int64_t now = k_uptime_get();
+
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		if (rings[i].fill > 0 && now >= rings[i].flush_at_ms) {
+			publish_row(ctx, i);
+		}
+	}
+}
+
+/* Wait for samples no longer than the earliest pending batch deadline. */
+static k_timeout_t poll_timeout(struct context *ctx)
+{
+	int64_t now = k_uptime_get();
+	int64_t wait = POLL_TIMEOUT_MS;
+
+	if (!ctx->session_open) {
+		return K_MSEC(MAX(ctx->reconnect_at_ms - now, 0));
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		if (rings[i].fill > 0) {
+			wait = MIN(wait, MAX(rings[i].flush_at_ms - now, 0));
+		}
+	}
+
+	return K_MSEC(wait);
+}
+
+/* Close the rate window once it has run its length. */
+static void rate_window_update(struct context *ctx)
+{
+	int64_t now = k_uptime_get();
+	int64_t elapsed = now - ctx->rate_window_start_ms;
+
+	if (elapsed < RATE_WINDOW_MS) {
+		return;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		struct row_stats *st = &stats[i];
+
+		st->hz = (uint32_t)(((uint64_t)(st->samples - st->window_samples) * MSEC_PER_SEC) /
+				    (uint64_t)elapsed);
+		st->window_samples = st->samples;
+#if defined(CONFIG_STATS)
+		STATS_SET(stat_groups[i], samples, st->samples);
+		STATS_SET(stat_groups[i], puts, st->puts);
+		STATS_SET(stat_groups[i], put_errors, st->put_errors);
+		STATS_SET(stat_groups[i], bytes, (uint32_t)st->bytes);
+		STATS_SET(stat_groups[i], put_us_max, st->put_us.max);
+		STATS_SET(stat_groups[i], age_us_max, st->age_us.max);
+#endif
+	}
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ALLOC_STATS)
+	struct zenoh_alloc_stats alloc;
+
+	zenoh_alloc_stats_get(&alloc);
+	ctx->alloc_rate = (uint32_t)(((uint64_t)(alloc.allocs - ctx->alloc_window_count) *
+				      MSEC_PER_SEC) / (uint64_t)elapsed);
+	ctx->alloc_window_count = alloc.allocs;
+#endif
+
+	ctx->rate_window_start_ms = now;
+}
+
+#if SYNAPSE_ZENOH_RTCM3_INBOUND || SYNAPSE_ZENOH_INBOUND
+/* Cycle count an inbound sample handled now arrived at, at the earliest. */
+static inline uint32_t inbound_arrival_cyc(struct context *ctx)
+{
+#if Z_FEATURE_MULTI_THREAD == 0
+	return ctx->spin_done_cyc;
+#else
+	ARG_UNUSED(ctx);
+	return k_cycle_get_32();
+#endif
+}
+
+static void inbound_latency_record(struct inbound_latency *lat, uint32_t arrival_cyc)
+{
+	uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - arrival_cyc);
+
+	lat->count++;
+	lat->last_us = us;
+	lat->max_us = MAX(lat->max_us, us);
+}
+#endif
+
+#if SYNAPSE_ZENOH_RTCM3_INBOUND
+/* Republish the frames gathered in the topic buffer, if any. */
+static void rtcm3_publish(struct context *ctx, uint32_t arrival_cyc)
+{
+	if (ctx->rtcm3.data.size == 0) {
+		return;
+	}
+
+	zros_pub_update(&ctx->pub_rtcm3);
+	inbound_latency_record(&ctx->rtcm3_latency, arrival_cyc);
+	ctx->rtcm3.data.size = 0;
+}
+
+/*
+ * Append one whole frame to the topic buffer, publishing what is already
+ * there first if the frame would not fit beside it. The framer never hands
+ * over a frame larger than the buffer.
+ */
+static void rtcm3_frame_handler(const uint8_t *frame, size_t len, void *arg)
+{
+	struct context *ctx = arg;
+
+	if (ctx->rtcm3.data.size + len > sizeof(ctx->rtcm3.data.bytes)) {
+		rtcm3_publish(ctx, inbound_arrival_cyc(ctx));
+	}
+
+	memcpy(&ctx->rtcm3.data.bytes[ctx->rtcm3.data.size], frame, len);
+	ctx->rtcm3.data.size += len;
+}
+
+/*
+ * Feed the received bytes through the framer and republish the frames they
+ * complete on topic_rtcm3, where the RTCM3 forwarder picks them up and hands
+ * them to the GNSS receiver. Frames completed by one sample are merged into
+ * as few publications as fit; a frame split across samples waits in the
+ * framer for its tail. The payload slices are read in place. Runs in the
+ * zenoh read task (multi-thread) or inside zp_spin_once (single-thread);
+ * zros_topic_publish is thread-safe under both.
+ */
+static void rtcm3_recv_handler(z_loaned_sample_t *sample, void *arg)
+{
+	struct context *ctx = arg;
+	uint32_t arrival_cyc = inbound_arrival_cyc(ctx);
+	z_bytes_slice_iterator_t it = z_bytes_get_slice_iterator(z_sample_payload(sample));
+	z_view_slice_t slice;
+
+	while (z_bytes_slice_iterator_next(&it, &slice)) {
+		rtcm3_framer_feed(&ctx->rtcm3_framer, z_slice_data(z_loan(slice)),
+				  z_slice_len(z_loan(slice)), rtcm3_frame_handler, ctx);
+	}
+
+	rtcm3_publish(ctx, arrival_cyc);
+}
+
+/*
+ * Declare the rtcm3 subscriber on the current session. Whatever the framer
+ * held from a previous session is the head of a frame whose tail is gone.
+ */
+static int zenoh_rtcm3_sub_declare(struct context *ctx)
+{
+	char keyexpr[KEYEXPR_MAX];
+	z_owned_closure_sample_t closure;
+	z_view_keyexpr_t ke;
+	int ret;
+
+	ctx->rtcm3.data.size = 0;
+	ctx->rtcm3_framer.len = 0;
+
+	ret = topic_keyexpr(SYNAPSE_TOPIC_RTCM3_KEY, keyexpr, sizeof(keyexpr));
+	if (ret < 0) {
+		LOG_ERR("Key expression too long for %s", SYNAPSE_TOPIC_RTCM3_KEY);
+		return ret;
+	}
+
+	ret = z_view_keyexpr_from_str(&ke, keyexpr);
+	if (ret < 0) {
+		LOG_ERR("Invalid key expression %s", keyexpr);
+		return ret;
+	}
+
+	z_closure_sample(&closure, rtcm3_recv_handler, NULL, ctx);
+
+	ret = z_declare_subscriber(z_loan(ctx->session), &ctx->rtcm3_reader, z_loan(ke),
 				   z_move(closure), NULL);
 	if (ret < 0) {
 		LOG_ERR("Unable to declare subscriber %s", keyexpr);
 		return ret;
 	}
 
-	LOG_INF("Zenoh subscriber %s", keyexpr);
+	LOG_INF("Zenoh subscriber %s", keyexpr);
+	return 0;
+}
+#endif /* SYNAPSE_ZENOH_RTCM3_INBOUND */
+
+#if SYNAPSE_ZENOH_INBOUND
+/* nanopb input stream over the zenoh payload, read slice by slice. */
+static bool inbound_pb_read(pb_istream_t *stream, pb_byte_t *buf, size_t count)
+{
+	return z_bytes_reader_read(stream->state, buf, count) == count;
+}
+
+/*
+ * Check an inbound sample against its row's contract and size bound, decode
+ * it straight out of the zenoh payload into the row's message buffer and
+ * republish it. A rejected sample is counted and dropped; nothing is
+ * published from a partly decoded buffer. Runs where rtcm3_recv_handler runs.
+ */
+static void inbound_recv_handler(z_loaned_sample_t *sample, void *arg)
+{
+	struct inbound_row *in = arg;
+	const struct inbound_binding *binding = &inbound_table[in - inbound];
+	uint32_t arrival_cyc = inbound_arrival_cyc(in->ctx);
+	const z_loaned_bytes_t *payload = z_sample_payload(sample);
+	size_t len = z_bytes_len(payload);
+	z_bytes_reader_t reader;
+	pb_istream_t stream;
+
+	if (!z_encoding_equals(z_sample_encoding(sample), z_loan(in->contract))) {
+		in->bad_contract++;
+		return;
+	}
+
+	if (len > binding->max_size) {
+		in->bad_size++;
+		return;
+	}
+
+	reader = z_bytes_get_reader(payload);
+	stream = (pb_istream_t){
+		.callback = inbound_pb_read,
+		.state = &reader,
+		.bytes_left = len,
+	};
+	if (!pb_decode(&stream, binding->fields, binding->buffer)) {
+		in->bad_decode++;
+		LOG_WRN("%s: %s", binding->key, PB_GET_ERROR(&stream));
+		return;
+	}
+
+	zros_pub_update(&in->pub);
+	inbound_latency_record(&in->latency, arrival_cyc);
+}
+
+static int inbound_row_declare(struct context *ctx, size_t row)
+{
+	const struct inbound_binding *binding = &inbound_table[row];
+	struct inbound_row *in = &inbound[row];
+	char keyexpr[KEYEXPR_MAX];
+	z_owned_closure_sample_t closure;
+	z_view_keyexpr_t ke;
+	int ret;
+
+	ret = topic_keyexpr(binding->key, keyexpr, sizeof(keyexpr));
+	if (ret < 0) {
+		LOG_ERR("Key expression too long for %s", binding->key);
+		return ret;
+	}
+
+	ret = z_view_keyexpr_from_str(&ke, keyexpr);
+	if (ret < 0) {
+		LOG_ERR("Invalid key expression %s", keyexpr);
+		return ret;
+	}
+
+	ret = z_encoding_from_str(&in->contract, binding->contract);
+	if (ret < 0) {
+		LOG_ERR("Invalid contract for %s", binding->key);
+		return ret;
+	}
+
+	z_closure_sample(&closure, inbound_recv_handler, NULL, in);
+
+	ret = z_declare_subscriber(z_loan(ctx->session), &in->reader, z_loan(ke), z_move(closure),
+				   NULL);
+	if (ret < 0) {
+		LOG_ERR("Unable to declare subscriber %s", keyexpr);
+		return ret;
+	}
+
+	LOG_INF("Zenoh subscriber %s (%s)", keyexpr, binding->contract);
 	return 0;
 }
-#endif /* SYNAPSE_ZENOH_RTCM3_INBOUND */
+
+/* The zros side of the inbound rows, which outlives any one session. */
+static int zenoh_inbound_init(struct context *ctx)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(inbound_table); i++) {
+		struct inbound_row *in = &inbound[i];
+		int ret;
+
+		memset(in, 0, sizeof(*in));
+		in->ctx = ctx;
+		ret = zros_pub_init(&in->pub, &ctx->node, inbound_table[i].topic,
+				    inbound_table[i].buffer);
+		if (ret < 0) {
+			LOG_ERR("init pub %s failed: %d", inbound_table[i].key, ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int zenoh_inbound_declare(struct context *ctx)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(inbound_table); i++) {
+		int ret = inbound_row_declare(ctx, i);
+
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void zenoh_inbound_undeclare(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(inbound_table); i++) {
+		z_undeclare_subscriber(z_move(inbound[i].reader));
+		z_drop(z_move(inbound[i].contract));
+	}
+}
+
+static void zenoh_inbound_fini(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(inbound_table); i++) {
+		zros_pub_fini(&inbound[i].pub);
+	}
+}
+#endif /* SYNAPSE_ZENOH_INBOUND */
+
+#if SYNAPSE_ZENOH_LIVELINESS
+static int declare_liveliness_token(struct context *ctx, z_owned_liveliness_token_t *token,
+				    const char *keyexpr)
+{
+	z_view_keyexpr_t ke;
+	int ret;
+
+	ret = z_view_keyexpr_from_str(&ke, keyexpr);
+	if (ret < 0) {
+		LOG_ERR("Invalid key expression %s", keyexpr);
+		return ret;
+	}
+
+	ret = z_liveliness_declare_token(z_loan(ctx->session), token, z_loan(ke), NULL);
+	if (ret < 0) {
+		LOG_ERR("Unable to declare liveliness token %s", keyexpr);
+	}
+
+	return ret;
+}
+
+static int liveliness_declare(struct context *ctx)
+{
+	const char *node_key = CONFIG_SPINALI_SYNAPSE_ZENOH_NAMESPACE[0] != '\0'
+				       ? CONFIG_SPINALI_SYNAPSE_ZENOH_NAMESPACE
+				       : LIVELINESS_NODE_KEY;
+
+	return declare_liveliness_token(ctx, &node_token, node_key);
+}
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_LIVELINESS_ROWS)
+/*
+ * Hold a token for every row that is on and none for a row that is off. The
+ * shell switches rows from its own thread, so the run loop, which owns the
+ * session, follows it here once per pass. A token that fails to declare is
+ * retried on the next pass.
+ */
+static void liveliness_rows_sync(struct context *ctx)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		bool on = !atomic_test_bit(&disabled_rows, (int)i);
+		bool held = (row_tokens_declared & BIT(i)) != 0U;
+		char keyexpr[KEYEXPR_MAX];
+
+		if (on == held) {
+			continue;
+		}
+
+		if (!on) {
+			z_liveliness_undeclare_token(z_move(row_tokens[i]));
+			row_tokens_declared &= ~BIT(i);
+		} else if (topic_keyexpr(topic_table[i].key, keyexpr, sizeof(keyexpr)) == 0 &&
+			   declare_liveliness_token(ctx, &row_tokens[i], keyexpr) == 0) {
+			row_tokens_declared |= BIT(i);
+		}
+	}
+}
+#endif
+
+static void liveliness_undeclare(void)
+{
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_LIVELINESS_ROWS)
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		if ((row_tokens_declared & BIT(i)) != 0U) {
+			z_liveliness_undeclare_token(z_move(row_tokens[i]));
+		}
+	}
+	row_tokens_declared = 0;
+#endif
+	z_liveliness_undeclare_token(z_move(node_token));
+}
+#endif /* SYNAPSE_ZENOH_LIVELINESS */
+
+/*
+ * Session supervision. Everything declared on a session goes with it, so a
+ * session is opened and closed together with every publisher and subscriber
+ * the tables describe; the zros side stays up throughout. The run loop opens
+ * the first session the same way it reopens a lost one.
+ */
+static void zenoh_session_close(struct context *ctx)
+{
+#if SYNAPSE_ZENOH_LIVELINESS
+	liveliness_undeclare();
+#endif
+#if SYNAPSE_ZENOH_LAST_VALUE
+	last_value_undeclare();
+#endif
+#if SYNAPSE_ZENOH_INBOUND
+	zenoh_inbound_undeclare();
+#endif
+#if SYNAPSE_ZENOH_RTCM3_INBOUND
+	z_undeclare_subscriber(z_move(ctx->rtcm3_reader));
+#endif
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+#if SYNAPSE_ZENOH_MATCHING
+		z_undeclare_matching_listener(z_move(matching_listeners[i]));
+#endif
+		z_undeclare_publisher(z_move(publishers[i]));
+	}
+	/* stops the read and lease tasks of a multi-thread build */
+	z_drop(z_move(ctx->session));
+	ctx->session_open = false;
+}
+
+static int zenoh_session_open(struct context *ctx)
+{
+	int ret;
+
+	ret = zenoh_session_init(ctx);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = zenoh_publishers_init(ctx);
+#if SYNAPSE_ZENOH_LAST_VALUE
+	if (ret == 0) {
+		ret = last_value_declare(ctx);
+	}
+#endif
+#if SYNAPSE_ZENOH_RTCM3_INBOUND
+	if (ret == 0) {
+		ret = zenoh_rtcm3_sub_declare(ctx);
+	}
+#endif
+#if SYNAPSE_ZENOH_INBOUND
+	if (ret == 0) {
+		ret = zenoh_inbound_declare(ctx);
+	}
+#endif
+#if SYNAPSE_ZENOH_LIVELINESS
+	/* last, so a host sees the board alive only once it is fully declared */
+	if (ret == 0) {
+		ret = liveliness_declare(ctx);
+	}
+#endif
+	if (ret < 0) {
+		zenoh_session_close(ctx);
+		return ret;
+	}
+
+	ctx->session_open = true;
+	ctx->link_errors = 0;
+#if Z_FEATURE_MULTI_THREAD == 0
+	/* the first spin drains only what arrived since the session opened */
+	ctx->spin_done_cyc = k_cycle_get_32();
+#endif
+#if SYNAPSE_ZENOH_ON_CHANGE
+	/* a fresh session gets every row's next sample, changed or not */
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		sent_at_ms[i] = -1;
+	}
+#endif
+	return 0;
+}
+
+/*
+ * Called once per loop pass. An open session is checked for loss: zenoh-pico
+ * closing it, or a run of failed puts and spins. A lost session is torn down
+ * and reopened at once, then after waits that double from
+ * RECONNECT_MIN_MS up to RECONNECT_MAX_MS, so a brief link drop costs little
+ * more than the drop itself while a long outage does not spin on z_open.
+ */
+static void zenoh_supervise(struct context *ctx)
+{
+	int64_t now = k_uptime_get();
+
+	if (ctx->session_open) {
+		if (ctx->link_errors < SESSION_LOST_ERRORS &&
+		    !z_session_is_closed(z_loan(ctx->session))) {
+			return;
+		}
+
+		LOG_WRN("Zenoh session lost");
+		zenoh_session_close(ctx);
+		ctx->lost_at_ms = now;
+		ctx->reconnect_at_ms = now;
+		ctx->backoff_ms = CONFIG_SPINALI_SYNAPSE_ZENOH_RECONNECT_MIN_MS;
+		return;
+	}
+
+	if (now < ctx->reconnect_at_ms) {
+		return;
+	}
+
+	if (zenoh_session_open(ctx) < 0) {
+		ctx->reconnect_at_ms = k_uptime_get() + ctx->backoff_ms;
+		ctx->backoff_ms = MIN(ctx->backoff_ms * 2U,
+				      CONFIG_SPINALI_SYNAPSE_ZENOH_RECONNECT_MAX_MS);
+		return;
+	}
+
+	ctx->opened_at_ms = k_uptime_get();
+	ctx->first_put_pending = true;
+	if (ctx->lost_at_ms >= 0) {
+		ctx->reconnects++;
+		ctx->last_outage_ms = (uint32_t)(ctx->opened_at_ms - ctx->lost_at_ms);
+		LOG_INF("Zenoh session reopened after %u ms", ctx->last_outage_ms);
+	}
+}
+
+/* The rate a row asks zros for: its own, or the finest the tick resolves. */
+static uint32_t row_sub_rate(size_t row)
+{
+	if (topic_table[row].rate_hz == RATE_EVERY_SAMPLE) {
+		return CONFIG_SYS_CLOCK_TICKS_PER_SEC;
+	}
+
+	return topic_table[row].rate_hz;
+}
 
 static int zenoh_init(struct context *ctx)
 {
@@ -348,31 +1977,77 @@ static int zenoh_init(struct context *ctx)
 	zros_node_init(&ctx->node, "zenoh");
 
 	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		memset(&rings[i], 0, sizeof(rings[i]));
+		memset(&stats[i], 0, sizeof(stats[i]));
+#if SYNAPSE_ZENOH_LAST_VALUE
+		last_value_valid[i] = false;
+#endif
 		ret = zros_sub_init(&subs[i], &ctx->node, topic_table[i].topic,
-				    topic_table[i].buffer, 70);
+				    row_slot(i, 0), row_sub_rate(i));
 		if (ret < 0) {
 			LOG_ERR("init sub %s failed: %d", topic_table[i].key, ret);
 			return ret;
 		}
 	}
 
-	ret = zenoh_session_init(ctx);
+#if SYNAPSE_ZENOH_RTCM3_INBOUND
+	ret = zros_pub_init(&ctx->pub_rtcm3, &ctx->node, &topic_rtcm3, &ctx->rtcm3);
 	if (ret < 0) {
+		LOG_ERR("init pub rtcm3 failed: %d", ret);
 		return ret;
 	}
+	rtcm3_framer_init(&ctx->rtcm3_framer, sizeof(ctx->rtcm3.data.bytes));
+#endif
 
-	ret = zenoh_publishers_init(ctx);
+#if SYNAPSE_ZENOH_INBOUND
+	ret = zenoh_inbound_init(ctx);
 	if (ret < 0) {
 		return ret;
 	}
+#endif
 
-#if SYNAPSE_ZENOH_RTCM3_INBOUND
-	ret = zenoh_rtcm3_sub_init(ctx);
-	if (ret < 0) {
-		return ret;
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		events[i] = *zros_sub_get_event(&subs[i]);
+	}
+	k_poll_signal_reset(&ctx->wake);
+	k_poll_event_init(&events[WAKE_EVENT], K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY,
+			  &ctx->wake);
+
+#if defined(CONFIG_PTP_CLOCK)
+	ctx->phc = net_eth_get_ptp_clock(net_if_get_default());
+	if (ctx->phc != NULL && !device_is_ready(ctx->phc)) {
+		ctx->phc = NULL;
+	}
+#endif
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_LINK_UDP)
+	if (strncmp(CONFIG_ZENOH_LOCATOR, "udp/", 4) != 0) {
+		LOG_WRN("UDP link selected, but the locator is %s", CONFIG_ZENOH_LOCATOR);
 	}
 #endif
 
+	/* the run loop opens the session on its first pass */
+	ctx->session_open = false;
+	ctx->reconnects = 0;
+	ctx->backoff_ms = CONFIG_SPINALI_SYNAPSE_ZENOH_RECONNECT_MIN_MS;
+	ctx->reconnect_at_ms = k_uptime_get();
+	ctx->lost_at_ms = -1;
+	ctx->first_put_pending = false;
+	ctx->last_outage_ms = 0;
+	ctx->last_first_put_ms = 0;
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+	ctx->shed_level = 0;
+	ctx->shed_clear_periods = 0;
+	ctx->shed_period_start_ms = k_uptime_get();
+	ctx->shed_puts = 0;
+	ctx->shed_put_errors = 0;
+	ctx->shed_backlog = 0;
+	ctx->shed_put_us = 0;
+	memset(shed_skipped, 0, sizeof(shed_skipped));
+#endif
+
+	ctx->rate_window_start_ms = k_uptime_get();
 	k_sem_take(&ctx->running, K_FOREVER);
 	LOG_INF("init");
 	return 0;
@@ -380,13 +2055,15 @@ static int zenoh_init(struct context *ctx)
 
 static int zenoh_fini(struct context *ctx)
 {
+	if (ctx->session_open) {
+		zenoh_session_close(ctx);
+	}
 #if SYNAPSE_ZENOH_RTCM3_INBOUND
-	z_undeclare_subscriber(z_move(ctx->rtcm3_reader));
 	zros_pub_fini(&ctx->pub_rtcm3);
 #endif
-	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
-		z_undeclare_publisher(z_move(publishers[i]));
-	}
+#if SYNAPSE_ZENOH_INBOUND
+	zenoh_inbound_fini();
+#endif
 	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
 		zros_sub_fini(&subs[i]);
 	}
@@ -411,31 +2088,70 @@ static void zenoh_run(void *p0, void *p1, void *p2)
 	}
 
 	while (k_sem_take(&ctx->running, K_NO_WAIT) < 0) {
-		struct k_poll_event events[ARRAY_SIZE(topic_table)];
+		uint32_t ready = 0;
 
+		(void)k_poll(events, ARRAY_SIZE(events), poll_timeout(ctx));
+
+		/* k_poll leaves the state of fired events set; clear it for reuse */
 		for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
-			events[i] = *zros_sub_get_event(&subs[i]);
+			if (events[i].state != K_POLL_STATE_NOT_READY) {
+				events[i].state = K_POLL_STATE_NOT_READY;
+				ready |= BIT(i);
+			}
 		}
-
-		int rc = k_poll(events, ARRAY_SIZE(events), K_MSEC(1000));
-
-		if (rc != 0) {
-			LOG_DBG("poll timeout");
+		if (events[WAKE_EVENT].state != K_POLL_STATE_NOT_READY) {
+			events[WAKE_EVENT].state = K_POLL_STATE_NOT_READY;
+			k_poll_signal_reset(&ctx->wake);
 		}
 
-		for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
-			if (zros_sub_update(&subs[i]) == 0) {
-				publish_struct(z_loan(publishers[i]), topic_table[i].buffer,
-					       topic_table[i].size);
+		/* Without a session, samples are still taken, to keep the poll
+		 * set quiet, but go nowhere.
+		 */
+		while (ready != 0) {
+			size_t i = (size_t)find_lsb_set(ready) - 1U;
+
+			ready &= ready - 1U;
+			if (!payload_ring_claim(i)) {
+				/* Take the sample and drop it: one left pending in
+				 * zros keeps its event signalled, and the loop
+				 * would spin against the tasks that free the slots.
+				 */
+				subs[i]._msg = &no_slot_sample;
+				(void)zros_sub_update(&subs[i]);
+				stats[i].no_slot++;
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+				ctx->shed_backlog++;
+#endif
+				continue;
+			}
+			if (zros_sub_update(&subs[i]) == 0 && ctx->session_open) {
+				row_sample(ctx, i);
 			}
 		}
 
+		if (ctx->session_open) {
+			flush_due_batches(ctx);
+#if SYNAPSE_ZENOH_LIVELINESS && defined(CONFIG_SPINALI_SYNAPSE_ZENOH_LIVELINESS_ROWS)
+			liveliness_rows_sync(ctx);
+#endif
+
 #if Z_FEATURE_MULTI_THREAD == 0
-		/* Also services the inbound rtcm3 subscriber callback, if any.
-		 * In multi-thread builds the read task does this instead.
-		 */
-		zp_spin_once(z_loan(ctx->session));
+			/* Also services the inbound subscriber callbacks, if any.
+			 * In multi-thread builds the read task does this instead.
+			 */
+			if (zp_spin_once(z_loan(ctx->session)) < 0) {
+				ctx->link_errors++;
+			}
+			ctx->spin_done_cyc = k_cycle_get_32();
+#endif
+		}
+
+		zenoh_supervise(ctx);
+
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+		shed_update(ctx);
 #endif
+		rate_window_update(ctx);
 	}
 
 	zenoh_fini(ctx);
@@ -465,25 +2181,155 @@ static int zenoh_cmd_handler(const struct shell *sh, size_t argc, char **argv, v
 	} else if (strcmp(argv[0], "stop") == 0) {
 		if (k_sem_count_get(&ctx->running) == 0) {
 			k_sem_give(&ctx->running);
+			k_poll_signal_raise(&ctx->wake, 0);
 		} else {
 			shell_print(sh, "not running");
 		}
 	} else if (strcmp(argv[0], "status") == 0) {
 		shell_print(sh, "running: %d", (int)(k_sem_count_get(&ctx->running) == 0));
+		shell_print(sh, "session: %s via %s", ctx->session_open ? "open" : "closed",
+			    CONFIG_ZENOH_LOCATOR);
+		shell_print(sh, "reconnects %u, last outage %u ms, first sample after %u ms",
+			    ctx->reconnects, ctx->last_outage_ms, ctx->last_first_put_ms);
+		shell_print(sh, "publish: %s",
+			    IS_ENABLED(CONFIG_SPINALI_SYNAPSE_ZENOH_ZERO_COPY) ? "zero-copy" : "copy");
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_SHED)
+		shell_print(sh, "shed: level %u of %u, %u clear periods", ctx->shed_level,
+			    SHED_LEVEL_MAX, ctx->shed_clear_periods);
+#endif
+#if defined(CONFIG_SPINALI_SYNAPSE_ZENOH_ALLOC_STATS)
+		struct zenoh_alloc_stats alloc;
+
+		zenoh_alloc_stats_get(&alloc);
+		shell_print(sh, "alloc: %u/s, total %u, free %u, fail %u", ctx->alloc_rate,
+			    alloc.allocs, alloc.frees, alloc.failures);
+		if (alloc.arena_size > 0) {
+			shell_print(sh, "arena: %zu of %zu bytes, peak %zu, largest refused %zu",
+				    alloc.arena_used, alloc.arena_size, alloc.arena_peak,
+				    alloc.largest_failure);
+		}
+#endif
+		for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+			char requested[16];
+
+			if (topic_table[i].rate_hz == RATE_EVERY_SAMPLE) {
+				snprintf(requested, sizeof(requested), "every sample");
+			} else {
+				snprintf(requested, sizeof(requested), "%u Hz",
+					 (unsigned int)topic_table[i].rate_hz);
+			}
+			shell_print(sh, "%-8s requested %s, effective %u Hz%s%s", topic_table[i].key,
+				    requested, stats[i].hz,
+				    atomic_test_bit(&disabled_rows, (int)i) ? ", off" : "",
+				    row_matched(i) ? "" : ", no subscriber");
+		}
+#if SYNAPSE_ZENOH_RTCM3_INBOUND
+		shell_print(sh, "rtcm3: %u frames in %u publications, inbound latency last %u us, "
+			    "worst %u us",
+			    ctx->rtcm3_framer.frames, ctx->rtcm3_latency.count,
+			    ctx->rtcm3_latency.last_us, ctx->rtcm3_latency.max_us);
+		shell_print(sh, "rtcm3: bad crc %u, oversize %u, skipped %u bytes",
+			    ctx->rtcm3_framer.bad_crc, ctx->rtcm3_framer.oversize,
+			    ctx->rtcm3_framer.skipped);
+#endif
+#if SYNAPSE_ZENOH_INBOUND
+		for (size_t i = 0; i < ARRAY_SIZE(inbound_table); i++) {
+			const struct inbound_row *in = &inbound[i];
+
+			shell_print(sh,
+				    "%s: %u in, rejected contract %u, size %u, decode %u, "
+				    "latency last %u us, worst %u us",
+				    inbound_table[i].key, in->latency.count, in->bad_contract,
+				    in->bad_size, in->bad_decode, in->latency.last_us,
+				    in->latency.max_us);
+		}
+#endif
+	} else if (strcmp(argv[0], "stats") == 0) {
+		for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+			const struct row_stats *st = &stats[i];
+
+			shell_print(sh,
+				    "%s: samples %u, disabled %u, unmatched %u, shed %u, "
+				    "no slot %u, unchanged %u, puts %u, put errors %u, bytes %llu, "
+				    "queries %u",
+				    topic_table[i].key, st->samples, st->disabled, st->unmatched,
+				    st->shed, st->no_slot, st->unchanged, st->puts, st->put_errors,
+				    (unsigned long long)st->bytes,
+				    (unsigned int)atomic_get(&st->queries));
+			hist_print(sh, "put duration", &st->put_us);
+			hist_print(sh, "sample age at put", &st->age_us);
+		}
 	}
 
 	return 0;
 }
 
-SHELL_SUBCMD_DICT_SET_CREATE(sub_zenoh, zenoh_cmd_handler,
-			     (start, &g_ctx, "start"),
-			     (stop, &g_ctx, "stop"),
-			     (status, &g_ctx, "status"));
+static int cmd_zenoh(const struct shell *sh, size_t argc, char **argv)
+{
+	return zenoh_cmd_handler(sh, argc, argv, &g_ctx);
+}
+
+/*
+ * Switch a row off or back on at runtime. An off row keeps its subscription
+ * and last-value cache but puts nothing, the way an unmatched row does.
+ */
+static int cmd_zenoh_row(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		if (strcmp(argv[1], topic_table[i].key) != 0) {
+			continue;
+		}
+
+		if (strcmp(argv[2], "on") == 0) {
+			atomic_clear_bit(&disabled_rows, (int)i);
+		} else if (strcmp(argv[2], "off") == 0) {
+			atomic_set_bit(&disabled_rows, (int)i);
+		} else {
+			shell_error(sh, "expected on or off");
+			return -EINVAL;
+		}
+		return 0;
+	}
+
+	shell_error(sh, "no row %s", argv[1]);
+	return -ENOENT;
+}
+
+/* Completes the row argument with the keys of the rows this build carries. */
+static void row_key_get(size_t idx, struct shell_static_entry *entry)
+{
+	entry->syntax = idx < ARRAY_SIZE(topic_table) ? topic_table[idx].key : NULL;
+	entry->help = NULL;
+	entry->subcmd = NULL;
+	entry->handler = NULL;
+}
+
+SHELL_DYNAMIC_CMD_CREATE(dsub_zenoh_row, row_key_get);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_zenoh,
+			       SHELL_CMD(start, NULL, "start", cmd_zenoh),
+			       SHELL_CMD(stop, NULL, "stop", cmd_zenoh),
+			       SHELL_CMD(status, NULL, "status", cmd_zenoh),
+			       SHELL_CMD(stats, NULL, "per-row counters and histograms", cmd_zenoh),
+			       SHELL_CMD_ARG(row, &dsub_zenoh_row, "row <key> on|off", cmd_zenoh_row,
+					     3, 0),
+			       SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(zenoh, &sub_zenoh, "zenoh commands", NULL);
 
 static int zenoh_sys_init(void)
 {
+#if defined(CONFIG_STATS)
+	/* registered once; the groups outlive any stop and restart */
+	for (size_t i = 0; i < ARRAY_SIZE(topic_table); i++) {
+		snprintf(stat_group_names[i], sizeof(stat_group_names[i]), "zenoh_%s",
+			 topic_table[i].key);
+		(void)STATS_INIT_AND_REG(stat_groups[i], STATS_SIZE_32, stat_group_names[i]);
+	}
+#endif
+
 	return start(&g_ctx);
 }
 
@@ -0,0 +1,138 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Streaming RTCM3 framer.
+ *
+ * A caster hands the bridge RTCM3 as a byte stream: one zenoh sample may hold
+ * a burst of frames, or end part way through one. The framer buffers at most
+ * one frame, hunts for the 0xD3 preamble, reads the 10-bit length and checks
+ * the trailing CRC-24Q before it lets a frame out, so the receiver only ever
+ * sees whole, intact frames. A candidate that fails its CRC is taken to be a
+ * false preamble, and the hunt resumes from the byte after it.
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include "rtcm3.h"
+
+#define CRC24Q_POLY 0x1864CFBU
+
+uint32_t rtcm3_crc24q(const uint8_t *data, size_t len)
+{
+	uint32_t crc = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		crc ^= (uint32_t)data[i] << 16;
+		for (int bit = 0; bit < 8; bit++) {
+			crc <<= 1;
+			if (crc & 0x1000000U) {
+				crc ^= CRC24Q_POLY;
+			}
+		}
+	}
+
+	return crc & 0xFFFFFFU;
+}
+
+void rtcm3_framer_init(struct rtcm3_framer *f, size_t frame_max)
+{
+	memset(f, 0, sizeof(*f));
+	f->frame_max = frame_max;
+}
+
+/* Drop n bytes from the front of the buffer, then up to the next preamble. */
+static void framer_discard(struct rtcm3_framer *f, size_t n)
+{
+	const uint8_t *next;
+
+	next = memchr(&f->buf[n], RTCM3_PREAMBLE, f->len - n);
+	if (next != NULL) {
+		f->skipped += (uint32_t)(next - &f->buf[n]);
+		f->len -= (size_t)(next - f->buf);
+		memmove(f->buf, next, f->len);
+	} else {
+		f->skipped += (uint32_t)(f->len - n);
+		f->len = 0;
+	}
+}
+
+/* Header length field plus framing; meaningful once the header is buffered. */
+static size_t framer_frame_len(const struct rtcm3_framer *f)
+{
+	size_t payload = ((size_t)(f->buf[1] & 0x03U) << 8) | f->buf[2];
+
+	return RTCM3_HEADER_LEN + payload + RTCM3_CRC_LEN;
+}
+
+/* Emit or reject every frame the buffered bytes complete. */
+static void framer_drain(struct rtcm3_framer *f, rtcm3_frame_cb cb, void *arg)
+{
+	while (f->len >= RTCM3_HEADER_LEN) {
+		size_t frame_len;
+		const uint8_t *crc;
+
+		/* six reserved bits follow the preamble and are always zero */
+		if ((f->buf[1] & 0xFCU) != 0) {
+			f->skipped++;
+			framer_discard(f, 1);
+			continue;
+		}
+
+		frame_len = framer_frame_len(f);
+		if (f->len < frame_len) {
+			return;
+		}
+
+		crc = &f->buf[frame_len - RTCM3_CRC_LEN];
+		if (rtcm3_crc24q(f->buf, frame_len - RTCM3_CRC_LEN) !=
+		    (((uint32_t)crc[0] << 16) | ((uint32_t)crc[1] << 8) | crc[2])) {
+			f->bad_crc++;
+			f->skipped++;
+			framer_discard(f, 1);
+			continue;
+		}
+
+		if (frame_len > f->frame_max) {
+			f->oversize++;
+		} else {
+			f->frames++;
+			cb(f->buf, frame_len, arg);
+		}
+		framer_discard(f, frame_len);
+	}
+}
+
+void rtcm3_framer_feed(struct rtcm3_framer *f, const uint8_t *data, size_t len, rtcm3_frame_cb cb,
+		       void *arg)
+{
+	while (len > 0) {
+		size_t want;
+		size_t take;
+
+		if (f->len == 0) {
+			const uint8_t *start = memchr(data, RTCM3_PREAMBLE, len);
+			size_t skip = start != NULL ? (size_t)(start - data) : len;
+
+			f->skipped += (uint32_t)skip;
+			data += skip;
+			len -= skip;
+			if (len == 0) {
+				return;
+			}
+		}
+
+		want = f->len < RTCM3_HEADER_LEN ? RTCM3_HEADER_LEN : framer_frame_len(f);
+		take = MIN(want - f->len, len);
+		memcpy(&f->buf[f->len], data, take);
+		f->len += take;
+		data += take;
+		len -= take;
+
+		framer_drain(f, cb, arg);
+	}
+}
+
+/* vi: ts=4 sw=4 et */
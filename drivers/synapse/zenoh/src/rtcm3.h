@@ -0,0 +1,40 @@
+/*
+ * Copyright CogniPilot Foundation 2025
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Streaming RTCM3 framer for the inbound corrections path, see rtcm3.c.
+ */
+
+#ifndef SYNAPSE_ZENOH_RTCM3_H
+#define SYNAPSE_ZENOH_RTCM3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RTCM3_PREAMBLE    0xD3
+#define RTCM3_HEADER_LEN  3
+#define RTCM3_CRC_LEN     3
+#define RTCM3_PAYLOAD_MAX 1023
+#define RTCM3_FRAME_MAX   (RTCM3_HEADER_LEN + RTCM3_PAYLOAD_MAX + RTCM3_CRC_LEN)
+
+/* Called once per complete, CRC-checked frame, preamble through CRC. */
+typedef void (*rtcm3_frame_cb)(const uint8_t *frame, size_t len, void *arg);
+
+struct rtcm3_framer {
+	uint8_t buf[RTCM3_FRAME_MAX];
+	size_t len; /* bytes held in buf, starting at a candidate preamble */
+	size_t frame_max; /* longest frame the consumer can take */
+	uint32_t frames; /* delivered */
+	uint32_t bad_crc; /* candidate frames whose CRC-24Q did not match */
+	uint32_t oversize; /* valid frames longer than frame_max, dropped */
+	uint32_t skipped; /* bytes discarded outside any frame */
+};
+
+void rtcm3_framer_init(struct rtcm3_framer *f, size_t frame_max);
+void rtcm3_framer_feed(struct rtcm3_framer *f, const uint8_t *data, size_t len, rtcm3_frame_cb cb,
+		       void *arg);
+uint32_t rtcm3_crc24q(const uint8_t *data, size_t len);
+
+#endif /* SYNAPSE_ZENOH_RTCM3_H */
+
+/* vi: ts=4 sw=4 et */
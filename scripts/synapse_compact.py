@@ -0,0 +1,122 @@
+"""
+Decoder for the compact quantized IMU and mag payloads the zenoh bridge puts
+when SPINALI_SYNAPSE_ZENOH_IMU_COMPACT or _MAG_COMPACT is set
+(drivers/synapse/zenoh/src/compact.h).
+
+A compact payload is a 32-byte header followed by count samples. Vectors are
+int16 on a per-batch scale, timestamps are delta coded in dt_unit_ns ticks,
+and the temperature, time status and id are carried once per batch. decode()
+checks the value contract and the layout, and returns the header and the
+samples with their vectors and timestamps restored.
+"""
+
+import struct
+from typing import NamedTuple
+
+IMU_TYPE = "synapse.zenoh.CompactInertialBatch"
+MAG_TYPE = "synapse.zenoh.CompactMagneticBatch"
+IMU_CONTRACT = f"application/x-synapse-struct;type={IMU_TYPE};version=1"
+MAG_CONTRACT = f"application/x-synapse-struct;type={MAG_TYPE};version=1"
+
+# CompactHeader: timestamp_ns, dt_unit_ns, sequence, count, sample_size,
+# scale[2], temperature_cc, time_status, id.
+HEADER_FORMAT = "<QIIHH2fhBB"
+# CompactInertialSample: accel_flu[3], gyro_flu[3], dt, flags.
+IMU_SAMPLE_FORMAT = "<3h3hBB"
+# CompactMagneticSample: mag_flu[3], dt, flags.
+MAG_SAMPLE_FORMAT = "<3hBB"
+
+assert struct.calcsize(HEADER_FORMAT) == 32
+assert struct.calcsize(IMU_SAMPLE_FORMAT) == 14
+assert struct.calcsize(MAG_SAMPLE_FORMAT) == 8
+
+# temperature_cc of a batch whose temperature was not finite
+TEMPERATURE_UNKNOWN = -32768
+
+
+class Header(NamedTuple):
+    timestamp_ns: int
+    dt_unit_ns: int
+    sequence: int
+    count: int
+    sample_size: int
+    scale: tuple
+    temperature_cc: int
+    time_status: int
+    id: int
+
+    @property
+    def temperature_c(self):
+        if self.temperature_cc == TEMPERATURE_UNKNOWN:
+            return float("nan")
+        return self.temperature_cc / 100.0
+
+
+class InertialSample(NamedTuple):
+    timestamp_ns: int
+    accel_flu_m_s2: tuple
+    gyro_flu_rad_s: tuple
+    flags: int
+
+
+class MagneticSample(NamedTuple):
+    timestamp_ns: int
+    mag_flu_tesla: tuple
+    flags: int
+
+
+class DecodeError(ValueError):
+    pass
+
+
+def compact_type(encoding):
+    """The compact type an encoding string names, or None."""
+    for type_name in (IMU_TYPE, MAG_TYPE):
+        if f"type={type_name};" in encoding:
+            return type_name
+    return None
+
+
+def is_compact(encoding):
+    return compact_type(encoding) is not None
+
+
+def decode(encoding, payload):
+    """Decode one compact payload; return (Header, [samples])."""
+    type_name = compact_type(encoding)
+    if type_name is None or not encoding.endswith(";version=1"):
+        raise DecodeError(f"not a compact version 1 contract: {encoding!r}")
+    sample_format = IMU_SAMPLE_FORMAT if type_name == IMU_TYPE else MAG_SAMPLE_FORMAT
+
+    offset = struct.calcsize(HEADER_FORMAT)
+    size = struct.calcsize(sample_format)
+    if len(payload) < offset:
+        raise DecodeError("payload shorter than the header")
+    fields = struct.unpack_from(HEADER_FORMAT, payload)
+    header = Header(*fields[:5], fields[5:7], *fields[7:])
+    if header.sample_size != size or len(payload) != offset + header.count * size:
+        raise DecodeError("payload length does not match count and sample_size")
+
+    samples = []
+    timestamp_ns = header.timestamp_ns
+    for n in range(header.count):
+        fields = struct.unpack_from(sample_format, payload, offset + n * size)
+        timestamp_ns += fields[-2] * header.dt_unit_ns
+        if type_name == IMU_TYPE:
+            samples.append(
+                InertialSample(
+                    timestamp_ns,
+                    tuple(q * header.scale[0] for q in fields[0:3]),
+                    tuple(q * header.scale[1] for q in fields[3:6]),
+                    fields[-1],
+                )
+            )
+        else:
+            samples.append(
+                MagneticSample(
+                    timestamp_ns,
+                    tuple(q * header.scale[0] for q in fields[0:3]),
+                    fields[-1],
+                )
+            )
+    return header, samples
@@ -0,0 +1,308 @@
+#!/usr/bin/env python3
+"""
+Host side of the zenoh bridge benchmark (app/zenoh_bench).
+Requires: pip install eclipse-zenoh
+
+Subscribes to the rows the bench feeds and, per row and in total, reports
+sustained messages/s and payload bytes/s, loss, and p50/p99 end-to-end
+latency. The bench stamps timestamp_ns with the host CLOCK_REALTIME, so
+latency is simply arrival time minus timestamp_ns. It also writes a
+per-stream sequence number into a field the bridge never interprets, and
+the bridge attaches its own put sequence to every put (src/attachment.h).
+Loss is the gaps in the put sequence, samples put but never received; shed
+is the rest of the gaps in the stream sequence, samples the bridge dropped
+before putting them, e.g. by load shedding. Without attachments the stream
+gaps are all counted as loss. Batched rows (contract ending in the batch
+suffix) are unpacked sample by sample. Compact IMU and mag rows
+(synapse_compact.py) are decoded too; their batches carry the temperature
+once, so the stream sequence is lost and shed is not known on them.
+
+Start zenohd and the bench first:
+  zenohd --listen tcp/127.0.0.1:7447
+  build/zephyr/zephyr.exe
+
+To compare the bridge's TCP and UDP links, save a --json summary of a run
+over each and pass both to --compare, which prints their loss and latency
+side by side.
+"""
+
+import argparse
+import json
+import struct
+import threading
+import time
+from pathlib import Path
+
+import zenoh
+
+import synapse_compact
+
+BATCH_SUFFIX = ";batch=synapse.zenoh.BatchHeader"
+BATCH_HEADER = "<IHH"
+# PutAttachment: put_ns, sequence, time_status, three reserved bytes.
+ATTACHMENT_FORMAT = "<QIB3x"
+
+# Row key -> (contract type, struct format, index of the sequence field).
+# Formats match the fixed-layout structs in drivers/synapse/topic/include.
+ROWS = {
+    "flow": ("synapse.topic.OpticalFlowData", "<QQQ2f3f2fII5f7Bx", 11),
+    "imu": ("synapse.topic.InertialSampleData", "<Q3f3ffBBBx", 7),
+    "gnss": ("synapse.topic.GnssFixData", "<QQ4i9Hh6B6x", 1),
+    "mag": ("synapse.topic.MagneticFieldData", "<Q3ffBBB5x", 4),
+}
+
+assert struct.calcsize(ROWS["flow"][1]) == 88
+assert struct.calcsize(ROWS["imu"][1]) == 40
+assert struct.calcsize(ROWS["gnss"][1]) == 64
+assert struct.calcsize(ROWS["mag"][1]) == 32
+assert struct.calcsize(ATTACHMENT_FORMAT) == 16
+
+
+class RowStats:
+    def __init__(self):
+        self.messages = 0
+        self.puts = 0
+        self.bytes = 0
+        self.first_seq = None
+        self.last_seq = None
+        self.first_put_seq = None
+        self.last_put_seq = None
+        self.latency_us = []
+        self.rejected = 0
+
+    def record(self, seq, latency_us):
+        self.messages += 1
+        self.latency_us.append(latency_us)
+        if seq is None:
+            return
+        if self.first_seq is None:
+            self.first_seq = seq
+        self.last_seq = seq if self.last_seq is None else max(self.last_seq, seq)
+
+    def record_put(self, seq):
+        if self.first_put_seq is None:
+            self.first_put_seq = seq
+        self.last_put_seq = seq if self.last_put_seq is None else max(self.last_put_seq, seq)
+
+    def published(self):
+        """Samples the bench published over the window, or None if unknown."""
+        if self.first_seq is None:
+            return None
+        return self.last_seq - self.first_seq + 1
+
+    def expected(self):
+        """Samples the bridge put over the window."""
+        if self.first_put_seq is not None:
+            # put loss, scaled to the samples the lost puts would have held
+            puts = self.last_put_seq - self.first_put_seq + 1
+            return round(self.messages * puts / self.puts)
+        return self.published() or 0
+
+
+def percentile(values, fraction):
+    if not values:
+        return None
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def summarize(stats, elapsed_s):
+    rows = {}
+    total = {"messages": 0, "bytes": 0, "expected": 0, "published": 0, "latency_us": []}
+    for key, row in stats.items():
+        expected = row.expected()
+        published = row.published()
+        shed = None
+        if published is not None:
+            shed = max(published - expected, 0) / published if published else 0.0
+            total["published"] += published
+        else:
+            total["published"] += expected
+        rows[key] = {
+            "messages": row.messages,
+            "puts": row.puts,
+            "rejected": row.rejected,
+            "msgs_per_s": row.messages / elapsed_s,
+            "bytes_per_s": row.bytes / elapsed_s,
+            "loss": (expected - row.messages) / expected if expected else 0.0,
+            "shed": shed,
+            "p50_us": percentile(row.latency_us, 0.50),
+            "p99_us": percentile(row.latency_us, 0.99),
+        }
+        total["messages"] += row.messages
+        total["bytes"] += row.bytes
+        total["expected"] += expected
+        total["latency_us"] += row.latency_us
+    rows["total"] = {
+        "messages": total["messages"],
+        "msgs_per_s": total["messages"] / elapsed_s,
+        "bytes_per_s": total["bytes"] / elapsed_s,
+        "loss": (
+            (total["expected"] - total["messages"]) / total["expected"]
+            if total["expected"]
+            else 0.0
+        ),
+        "shed": (
+            max(total["published"] - total["expected"], 0) / total["published"]
+            if total["published"]
+            else 0.0
+        ),
+        "p50_us": percentile(total["latency_us"], 0.50),
+        "p99_us": percentile(total["latency_us"], 0.99),
+    }
+    return rows
+
+
+def run(locator="tcp/127.0.0.1:7447", namespace="", duration=10.0, warmup=1.0):
+    """Subscribe for warmup + duration seconds; return the summary dict."""
+    config = zenoh.Config()
+    config.insert_json5("mode", '"client"')
+    config.insert_json5("connect/endpoints", json.dumps([locator]))
+    session = zenoh.open(config)
+
+    prefix = f"{namespace}/" if namespace else ""
+    stats = {key: RowStats() for key in ROWS}
+    lock = threading.Lock()
+    measuring = threading.Event()
+
+    def make_handler(key):
+        type_name, fmt, seq_index = ROWS[key]
+        size = struct.calcsize(fmt)
+
+        def handler(sample):
+            arrival_ns = time.time_ns()
+            if not measuring.is_set():
+                return
+            encoding = str(sample.encoding) if sample.encoding is not None else ""
+            payload = sample.payload.to_bytes()
+            row = stats[key]
+            with lock:
+                if synapse_compact.is_compact(encoding):
+                    try:
+                        header, samples = synapse_compact.decode(encoding, payload)
+                    except synapse_compact.DecodeError:
+                        row.rejected += 1
+                        return
+                    row.puts += 1
+                    row.bytes += len(payload)
+                    row.record_put(header.sequence)
+                    for s in samples:
+                        row.record(None, (arrival_ns - s.timestamp_ns) / 1000.0)
+                    return
+                if f"type={type_name};" not in encoding:
+                    row.rejected += 1
+                    return
+                offset = 0
+                count = 1
+                if encoding.endswith(BATCH_SUFFIX):
+                    _, count, sample_size = struct.unpack_from(BATCH_HEADER, payload)
+                    offset = struct.calcsize(BATCH_HEADER)
+                    if sample_size != size:
+                        row.rejected += 1
+                        return
+                if len(payload) != offset + count * size:
+                    row.rejected += 1
+                    return
+                row.puts += 1
+                row.bytes += len(payload)
+                attachment = sample.attachment.to_bytes() if sample.attachment else b""
+                if len(attachment) == struct.calcsize(ATTACHMENT_FORMAT):
+                    row.record_put(struct.unpack(ATTACHMENT_FORMAT, attachment)[1])
+                for n in range(count):
+                    fields = struct.unpack_from(fmt, payload, offset + n * size)
+                    latency_us = (arrival_ns - fields[0]) / 1000.0
+                    row.record(int(fields[seq_index]), latency_us)
+
+        return handler
+
+    subscribers = [
+        session.declare_subscriber(f"{prefix}{key}", make_handler(key)) for key in ROWS
+    ]
+
+    time.sleep(warmup)
+    measuring.set()
+    start = time.monotonic()
+    time.sleep(duration)
+    measuring.clear()
+    elapsed = time.monotonic() - start
+
+    for sub in subscribers:
+        sub.undeclare()
+    session.close()
+
+    with lock:
+        return summarize(stats, elapsed)
+
+
+def print_summary(summary):
+    print(
+        f"{'row':<6} {'msgs/s':>10} {'bytes/s':>12} {'loss':>8} {'shed':>8} "
+        f"{'p50 us':>10} {'p99 us':>10}"
+    )
+    for key, row in summary.items():
+        shed = f"{row['shed'] * 100:.2f}%" if row["shed"] is not None else "-"
+        p50 = f"{row['p50_us']:.0f}" if row["p50_us"] is not None else "-"
+        p99 = f"{row['p99_us']:.0f}" if row["p99_us"] is not None else "-"
+        print(
+            f"{key:<6} {row['msgs_per_s']:>10.1f} {row['bytes_per_s']:>12.0f} "
+            f"{row['loss'] * 100:>7.2f}% {shed:>8} {p50:>10} {p99:>10}"
+        )
+
+
+def print_comparison(summaries):
+    """Print loss, p50 and p99 of each row for each (label, summary) pair."""
+    labels = [label for label, _ in summaries]
+    header = f"{'row':<6}"
+    for metric in ("loss", "p50 us", "p99 us"):
+        header += "".join(f" {f'{metric} {label}':>14}" for label in labels)
+    print(header)
+    for key in summaries[0][1]:
+        line = f"{key:<6}"
+        rows = [summary.get(key) for _, summary in summaries]
+        line += "".join(
+            f" {row['loss'] * 100:>13.2f}%" if row else f" {'-':>14}" for row in rows
+        )
+        for metric in ("p50_us", "p99_us"):
+            line += "".join(
+                f" {row[metric]:>14.0f}" if row and row[metric] is not None else f" {'-':>14}"
+                for row in rows
+            )
+        print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--locator", default="tcp/127.0.0.1:7447", help="zenohd to connect to")
+    parser.add_argument(
+        "--namespace",
+        default="",
+        help="deployment namespace prefixing the bare catalog keys",
+    )
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds to measure")
+    parser.add_argument("--warmup", type=float, default=1.0, help="seconds to ignore first")
+    parser.add_argument("--json", action="store_true", help="print the summary as JSON")
+    parser.add_argument(
+        "--compare",
+        nargs="+",
+        metavar="SUMMARY.json",
+        help="compare saved --json summaries, e.g. of a tcp and a udp run, instead of measuring",
+    )
+    args = parser.parse_args()
+
+    if args.compare:
+        summaries = []
+        for path in args.compare:
+            with open(path) as f:
+                summaries.append((Path(path).stem, json.load(f)))
+        print_comparison(summaries)
+        return
+
+    summary = run(args.locator, args.namespace, args.duration, args.warmup)
+    if args.json:
+        print(json.dumps(summary, indent=2))
+    else:
+        print_summary(summary)
+
+
+if __name__ == "__main__":
+    main()
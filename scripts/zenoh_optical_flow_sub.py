@@ -8,12 +8,21 @@ v0.7.0 catalog, tagged with the value contract asserted below. Anything whose
 contract does not match is reported rather than decoded, because the payload
 carries no self-description that would let us notice a layout change.
 
+Every put also carries an attachment with the row's put sequence number and
+the time of the put (drivers/synapse/zenoh/src/attachment.h). Once a second
+the script prints, per topic, the puts lost on the way (gaps in the
+sequence), the time samples spent in the bridge (put time minus sample
+timestamp, one clock, so exact) and, for gPTP-stamped puts, the time they
+spent on the network (arrival minus put time). The latter assumes this host's
+CLOCK_TAI is disciplined to the same grandmaster, e.g. by ptp4l and phc2sys.
+
 Start zenohd first:
   zenohd --listen tcp/192.0.2.2:7447
 """
 
 import argparse
 import struct
+import threading
 import time
 
 import zenoh
@@ -37,8 +46,12 @@ FLOW_FORMAT = "<QQQ2f3f2fII5f7Bx"
 # there is no ENU velocity and no gyro or flow-rate field here.
 FLOW_VEL_FORMAT = "<Q2f3f4B"
 
+# PutAttachment: put_ns, sequence, time_status, three reserved bytes.
+ATTACHMENT_FORMAT = "<QIB3x"
+
 assert struct.calcsize(FLOW_FORMAT) == 88
 assert struct.calcsize(FLOW_VEL_FORMAT) == 32
+assert struct.calcsize(ATTACHMENT_FORMAT) == 16
 
 FLOW_FIELDS = (
     "timestamp_ns",
@@ -90,6 +103,68 @@ def time_status_name(value):
     return f"?{value}"
 
 
+TIME_STATUS_LOCAL_FREERUN = 0
+
+
+class PutStats:
+    """Loss and latency of one topic over the current report interval."""
+
+    def __init__(self):
+        self.next_seq = None
+        self.reset()
+
+    def reset(self):
+        self.puts = 0
+        self.lost = 0
+        self.bridge_us = []
+        self.network_us = []
+
+    def record(self, attachment, timestamp_ns, time_status, arrival_ns):
+        put_ns, seq, put_time_status = attachment
+        self.puts += 1
+        if self.next_seq is not None:
+            # the sequence is 32 bits and wraps; a reordered put counts as no loss
+            gap = (seq - self.next_seq) & 0xFFFFFFFF
+            if gap < 0x80000000:
+                self.lost += gap
+        self.next_seq = (seq + 1) & 0xFFFFFFFF
+        if put_time_status == time_status and put_ns >= timestamp_ns:
+            self.bridge_us.append((put_ns - timestamp_ns) / 1000.0)
+        if put_time_status != TIME_STATUS_LOCAL_FREERUN and arrival_ns is not None:
+            self.network_us.append((arrival_ns - put_ns) / 1000.0)
+
+    def summary(self):
+        sent = self.puts + self.lost
+        loss = 100.0 * self.lost / sent if sent else 0.0
+        return (
+            f"{self.puts} puts, lost {self.lost} ({loss:.2f}%), "
+            f"bridge {latency_summary(self.bridge_us)}, "
+            f"network {latency_summary(self.network_us)}"
+        )
+
+
+def latency_summary(values):
+    if not values:
+        return "-"
+    ordered = sorted(values)
+    p50 = ordered[len(ordered) // 2]
+    return f"p50 {p50:.0f} us max {ordered[-1]:.0f} us"
+
+
+def tai_now_ns():
+    clock = getattr(time, "CLOCK_TAI", None)
+    return time.clock_gettime_ns(clock) if clock is not None else None
+
+
+def decode_attachment(sample):
+    if sample.attachment is None:
+        return None
+    raw = sample.attachment.to_bytes()
+    if len(raw) != struct.calcsize(ATTACHMENT_FORMAT):
+        return None
+    return struct.unpack(ATTACHMENT_FORMAT, raw)
+
+
 def decode(payload, fmt, fields):
     if len(payload) != struct.calcsize(fmt):
         return None
@@ -119,8 +194,18 @@ def main():
     session = zenoh.open(zenoh.Config())
 
     counts = {"flow": 0, "flow_vel": 0}
+    puts = {"flow": PutStats(), "flow_vel": PutStats()}
+    puts_lock = threading.Lock()
     warned = set()
 
+    def account_put(sample, name, data):
+        arrival_ns = tai_now_ns()
+        attachment = decode_attachment(sample)
+        if attachment is None:
+            return
+        with puts_lock:
+            puts[name].record(attachment, data["timestamp_ns"], data["time_status"], arrival_ns)
+
     def check_contract(sample, expected, name):
         received = encoding_of(sample)
         if received == expected:
@@ -136,6 +221,7 @@ def main():
         data = decode(sample.payload.to_bytes(), FLOW_FORMAT, FLOW_FIELDS)
         if data is None:
             return
+        account_put(sample, "flow", data)
         counts["flow"] += 1
         if counts["flow"] % args.every:
             return
@@ -157,6 +243,7 @@ def main():
         data = decode(sample.payload.to_bytes(), FLOW_VEL_FORMAT, FLOW_VEL_FIELDS)
         if data is None:
             return
+        account_put(sample, "flow_vel", data)
         counts["flow_vel"] += 1
         if counts["flow_vel"] % args.every:
             return
@@ -180,6 +267,12 @@ def main():
             time.sleep(1)
             if counts["flow"] + counts["flow_vel"] == 0:
                 print("  (nothing received yet - is zenohd running? is ethernet up?)")
+                continue
+            with puts_lock:
+                for name, stats in puts.items():
+                    if stats.puts:
+                        print(f"[{name}] {stats.summary()}")
+                    stats.reset()
     except KeyboardInterrupt:
         pass
 